@@ -282,7 +282,7 @@ bool matchWildcard(const string& exp, const string& str)
     bool first = (*(parts.begin()) != "");
     for(list<string>::iterator e = parts.begin(); e != parts.end(); e++)
     {
-        unsigned int j = str.find(*e);
+        string::size_type j = str.find(*e);
         
         // This makes sure that the beginning is not a wildcard
         if(first && j != 0)
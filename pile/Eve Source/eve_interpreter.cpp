@@ -76,6 +76,8 @@ Interpreter::Interpreter()
     //, outputter("%s: @%d:%s")
     , outputter("%s:%d:%s")
     , allowDeclarations(true)
+    , onEnter(NULL)
+    , onLeave(NULL)
 {
     pushEnv(true);  // Push global scope
     
@@ -236,7 +238,7 @@ EvalState Interpreter::callFn(Function* fn, std::list<Token>& arguments)
     
     // Compare number of arguments
     if(fn->getBuiltIn() == FN_EXTERNAL)
-        return fn->call(*this, args);
+        return runFn(fn, args);
     if(args.size() > fn->getArgTypes().size())
     {
         error("Error: Too many arguments in function call.\n");
@@ -273,7 +275,23 @@ EvalState Interpreter::callFn(Function* fn, std::list<Token>& arguments)
         }
     }
     
-    return fn->call(*this, args);
+    return runFn(fn, args);
+}
+
+// Calls a function whose arguments are ready.
+EvalState Interpreter::runFn(Function* fn, std::vector<Variable*>& args)
+{
+    if(onEnter == NULL)
+        return fn->call(*this, args);
+    
+    std::string name = fn->text;
+    if(fn->isMethod && fn->parentObject != NULL)
+        name = fn->parentObject->text + "." + name;
+    onEnter("call", name);
+    EvalState result = fn->call(*this, args);
+    if(onLeave != NULL)
+        onLeave();
+    return result;
 }
 
 Variable* Interpreter::evaluateExpression(Variable* A, OperatorEnum operation)
@@ -478,6 +496,9 @@ bool Interpreter::readFile(string filename)
         currentFile = "";
         return false;
     }
+    filesRead.push_back(filename);
+    if(onEnter != NULL)
+        onEnter("file", filename);
     
     bool continuation = false;
     EvalState e_state;
@@ -544,6 +565,8 @@ bool Interpreter::readFile(string filename)
     
     fin.close();
     currentFile = "";
+    if(onLeave != NULL)
+        onLeave();
     
     return !errorFlag;
 }
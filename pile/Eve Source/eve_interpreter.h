@@ -102,6 +102,7 @@ public:
     bool literal;
     bool temp;
     bool reference;  // Used as a message to callFn that this should be passed by reference.
+    static unsigned long created;  // How many have been made, for profiling
     Variable(TypeEnum type, const std::string& text);
     TypeEnum getType();
     // Note: copy() uses covariant return types
@@ -438,6 +439,8 @@ public:
     
     SeparatorEnum sep;
     KeywordEnum keyword;
+    
+    static unsigned long lexed;  // How many tokenize1() has made, for profiling
 
     // Null token
     Token();
@@ -543,6 +546,7 @@ public:
     // FIXME: Move this to Scope!!!
     std::list<Class*> classDefs;
     std::string currentFile;
+    std::list<std::string> filesRead;  // Every file that readFile() has read
     unsigned int lineNumber;
     bool errorFlag;
     Outputter outputter;
@@ -550,6 +554,12 @@ public:
     Function* array_size;
     bool allowDeclarations;
     
+    // If set, these are called when a file is read or a function is called
+    // (with "file" or "call" and its name) and when it is done, like for
+    // profiling.
+    void (*onEnter)(const std::string& kind, const std::string& name);
+    void (*onLeave)();
+    
     Interpreter();
     
     void addClass(Class* c);
@@ -559,6 +569,7 @@ public:
     void error(const char* formatted_text, ...);
 
     EvalState callFn(Function* fn, std::list<Token>& arguments);
+    EvalState runFn(Function* fn, std::vector<Variable*>& args);
     
     Variable* evaluateExpression(Variable* A, OperatorEnum operation);
 
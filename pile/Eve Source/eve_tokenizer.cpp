@@ -20,6 +20,7 @@ using namespace std;
 
 extern Interpreter interpreter;
 
+unsigned long Token::lexed = 0;
 
 // Null token
 Token::Token()
@@ -931,6 +932,7 @@ list<Token> tokenize1(string& line, bool& continuation)
         }
     }
 
+    Token::lexed += tokens.size();
     return tokens;
 }
 
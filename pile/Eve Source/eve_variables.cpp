@@ -210,13 +210,17 @@ bool isConvertable(TypeEnum source, TypeEnum dest)
 
 
 
+unsigned long Variable::created = 0;
+
 Variable::Variable(TypeEnum type, const std::string& text)
         : type(type)
         , text(text)
         , literal(false)
         , temp(false)
         , reference(false)
-{}
+{
+    created++;
+}
 TypeEnum Variable::getType()
 {
     return type;
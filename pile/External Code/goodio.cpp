@@ -31,14 +31,18 @@ See goodio.h for details and license.
 using namespace std;
 
 
+unsigned long ioStatCount = 0;
+
 bool ioExists(const string& filename)
 {
+    ioStatCount++;
     return (access(filename.c_str(), 0) == 0);
 }
 
 bool ioIsDir(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     stat(filename.c_str(), &status);
 
     return (status.st_mode & S_IFDIR);
@@ -47,6 +51,7 @@ bool ioIsDir(const string& filename)
 bool ioIsFile(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     stat(filename.c_str(), &status);
 
     return (status.st_mode & S_IFREG);
@@ -54,16 +59,19 @@ bool ioIsFile(const string& filename)
 
 bool ioIsReadable(const string& filename)
 {
+    ioStatCount++;
     return (access(filename.c_str(), 4) == 0);
 }
 
 bool ioIsWriteable(const string& filename)
 {
+    ioStatCount++;
     return (access(filename.c_str(), 2) == 0);
 }
 
 bool ioIsReadWriteable(const string& filename)
 {
+    ioStatCount++;
     return (access(filename.c_str(), 6) == 0);
 }
 
@@ -306,6 +314,7 @@ string ioUniqueName(const string& filename, int startAt)
 int ioSize(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return -1;
     return status.st_size;
@@ -314,6 +323,7 @@ int ioSize(const string& filename)
 time_t ioTimeAccessed(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return -1;
     return status.st_atime;
@@ -322,6 +332,7 @@ time_t ioTimeAccessed(const string& filename)
 time_t ioTimeModified(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return -1;
     return status.st_mtime;
@@ -330,6 +341,7 @@ time_t ioTimeModified(const string& filename)
 time_t ioTimeStatus(const string& filename)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return -1;
     return status.st_ctime;
@@ -343,6 +355,7 @@ string ioTimeString(time_t time)
 bool ioSetReadable(const string& filename, bool readable)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return false;
     
@@ -365,6 +378,7 @@ bool ioSetReadable(const string& filename, bool readable)
 bool ioSetWriteable(const string& filename, bool writeable)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return false;
     
@@ -387,6 +401,7 @@ bool ioSetWriteable(const string& filename, bool writeable)
 bool ioSetReadWriteable(const string& filename, bool ReadWriteable)
 {
     struct stat status;
+    ioStatCount++;
     if(stat(filename.c_str(), &status) < 0)
         return false;
 
@@ -470,8 +485,8 @@ list<string> ioExplode(const string& str, char delimiter)
 {
     list<string> result;
     
-    unsigned int oldPos = 0;
-    unsigned int pos = str.find_first_of(delimiter);
+    string::size_type oldPos = 0;
+    string::size_type pos = str.find_first_of(delimiter);
     while(pos != string::npos)
     {
         result.push_back(str.substr(oldPos, pos - oldPos));
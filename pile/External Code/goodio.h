@@ -27,6 +27,7 @@ File info:
 	bool ioSetWriteable(const string& filename, bool writeable = true);  // Change 'write' permissions
 	bool ioSetReadWriteable(const string& filename, bool ReadWriteable = true);  // Change 'read' and 'write' permissions
 	list<string> ioList(const string& dirname, bool directories = true, bool files = true);  // Returns a list of files in the directory
+	unsigned long ioStatCount;  // How many times a file's info has been asked for (for profiling)
 
 File editing:
 	bool ioNew(const string& filename, bool readable = true, bool writeable = true);  // Create an empty file
@@ -150,6 +151,8 @@ std::string ioStripToExt(const std::string& filename);
 std::string ioUniqueName(const std::string& filename, int startAt = 1);
 
 // File info
+extern unsigned long ioStatCount;
+
 bool ioExists(const std::string& filename);
 
 bool ioIsDir(const std::string& filename);
@@ -16,16 +16,32 @@ config loading, GUI loading, and interpreter calls.
 #include "pile_global.h"
 #include "pile_env.h"
 #include "pile_config.h"
+#include "pile_daemon.h"
 #include "pile_depend.h"
+#include "pile_git.h"
+#include "pile_graph.h"
+#include "pile_history.h"
+#include "pile_report.h"
+#include "pile_timing.h"
+#include "pile_unity.h"
+#include "pile_ninja.h"
 #include "pile_commands.h"
 #include "pile_build.h"
+#include "pile_jobs.h"
 #include "pile_load.h"
+#include "pile_cache.h"
+#include "pile_shard.h"
+#include "pile_stats.h"
+#include "pile_trace.h"
 #include "pile_ui.h"
+#include "pile_watch.h"
+#include "pile_worker.h"
 #include "string_functions.h"
 #include <cstring>
 
 Environment env;
 Configuration config;
+extern Interpreter interpreter;
 
 void printDepends(const string& file);
 bool interpret(string filename, Environment& env, Configuration& config);
@@ -66,7 +82,7 @@ string findPileFile()
 
     for(list<string>::iterator e = ls.begin(); e != ls.end(); e++)
     {
-        unsigned int dotpos = e->find_last_of(".");
+        string::size_type dotpos = e->find_last_of(".");
         if(dotpos != string::npos && e->substr(dotpos, string::npos) == ".pile")
         {
             file = *e;
@@ -91,7 +107,7 @@ void generatePilefile(string name, int type)
         else
         {
             // Strip extension
-            unsigned int dot = base.find_last_of('.');
+            string::size_type dot = base.find_last_of('.');
             if(dot != string::npos)
                 base = base.substr(0, dot);
         }
@@ -237,69 +253,27 @@ void setLFlagHistory(const string& response)
 }
 
 /*
-The basic outline:
-Create config file if it doesn't exist.
-Delete the old log file if it exists.
-
+Runs pile with the given arguments, once pile.conf is loaded.  piled runs
+this for each build that it is sent.
 
+Takes: int (number of arguments, as given to main())
+       char*[] (arguments)
+Returns: int (exit code)
 */
-int main(int argc, char* argv[])
+int runPile(int argc, char* argv[])
 {
-
-    //string pileDirectory = ioGetProgramPath();
-
-    // Create config dir
-    ioNewDir(getConfigDir());
-
-    // Set log file
     string configDir = getConfigDir();
-    log_file = configDir + "pile_log.txt";
-    //log_file = "pile_log.txt";
-
-    // Delete log file
-    ioDelete(log_file);
-
-    UI_debug_pile("Starting up...\n");
-    UI_debug_pile("Argc = %d\n", argc);
-    for(int i = 0; i < argc; i++)
-    {
-        UI_debug_pile("Argv[%d] = %s\n", i, argv[i]);
-    }
-
-
-
-
-    // Load pile.conf
-    if(!ioExists(configDir))
-        ioNewDir(configDir);
-
-
-    UI_debug("Loading config.\n");
-    loadConfig(configDir, config);
-    UI_debug("Done loading config.\n");
-
-    env.loadConfig(config);
-
-    if(config.installPath == "")
-    {
-        SYS_alert(("Pile's install path has not been set!  Please edit " + configDir + "pile.conf and set the PILE_PATH string to the directory that contains the Pile installation.\n").c_str());
-        return 0;
-    }
-    else
-    {
-        /*if(!ioExists(addDirSlash(config.installPath) + ioStripToFile(argv[0])))
-        {
-            UI_error(("Pile's install path has not been set!  Please edit " + configDir + "pile.conf and set the PILE_PATH string to the directory that contains the Pile installation.\n").c_str());
-            return 0;
-        }*/
-    }
-
     string file;  // pilefile name
 
 
     int cleaning = 0;  // Interpret without actions or messages
     bool graphical = false;
+    bool showStats = false;
+    int history = 0;  // Builds for 'pile history' to list
+    int headerReport = 0;  // Headers for 'pile report headers' to list
     bool promptForNoPilefile = true;
+    bool affected = false;  // Just print what some changed files affect
+    list<string> changedFiles;
     // Check for graphical flag
     for(int i = 1; i < argc; i++)
     {
@@ -383,6 +357,33 @@ int main(int argc, char* argv[])
             // FIXME: Create/update dependency files (in depends directory?)
             return 0; // FIXME: Shouldn't always return here.
         }
+        else if(string("history") == argv[i])
+        {
+            // The number of builds to list can follow.
+            history = 10;
+            if(i+1 < argc && atoi(argv[i+1]) > 0)
+                history = atoi(argv[++i]);
+        }
+        else if(string("report") == argv[i])
+        {
+            if(i+1 >= argc || string("headers") != argv[i+1])
+            {
+                UI_error("pile error: 'pile report' needs a kind of report, like 'pile report headers'.\n");
+                return 1;
+            }
+            i++;
+            // The number of headers to list can follow.
+            headerReport = 20;
+            if(i+1 < argc && atoi(argv[i+1]) > 0)
+                headerReport = atoi(argv[++i]);
+        }
+        else if(string("affected") == argv[i])
+        {
+            // The rest of the arguments are changed files
+            affected = true;
+            for(i++; i < argc; i++)
+                changedFiles.push_back(absolutePath(argv[i]));
+        }
         else if(string("clean") == argv[i])
         {
             if(i+1 < argc && string("all") == argv[i+1])
@@ -404,6 +405,21 @@ int main(int argc, char* argv[])
         {
             env.dryRun = true;
         }
+        else if(string("--emit-ninja") == argv[i])
+        {
+            env.emitNinja = true;
+        }
+        else if(string("--stats") == argv[i])
+        {
+            showStats = true;
+        }
+        else if(string("--trace") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            startTrace(argv[i]);
+        }
         else if(string("--nocompile") == argv[i])
         {
             env.noCompile = true;
@@ -412,6 +428,89 @@ int main(int argc, char* argv[])
         {
             env.noLink = true;
         }
+        else if(string("-j") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            config.jobs = atoi(argv[i]);
+        }
+        else if(strncmp(argv[i], "-j", 2) == 0)
+        {
+            config.jobs = atoi(argv[i] + 2);
+        }
+        else if(string("--changes") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            config.changeDetection = argv[i];
+        }
+        else if(string("--shard") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            // "2/4" builds the second of four shards
+            string arg = argv[i];
+            string::size_type slash = arg.find('/');
+            env.shard = atoi(arg.substr(0, slash).c_str());
+            env.shardCount = (slash == string::npos? 0 : atoi(arg.substr(slash+1).c_str()));
+            if(env.shardCount < 1 || env.shard < 1 || env.shard > env.shardCount)
+            {
+                UI_error("pile error: --shard needs a shard and a count, like 2/4.\n");
+                return 0;
+            }
+        }
+        else if(string("--shard-times") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            env.shardTimes = argv[i];
+        }
+        else if(string("merge-shards") == argv[i])
+        {
+            // The rest of the arguments are the trees that the shards were built in
+            env.mergeShards = true;
+            for(i++; i < argc; i++)
+                env.shardDirs.push_back(argv[i]);
+        }
+        else if(string("--workers") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            config.workers = ioExplode(argv[i], ',');
+            config.workers.remove("");
+        }
+        else if(string("--cache") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            config.cache = argv[i];
+        }
+        else if(string("--cache-readonly") == argv[i])
+        {
+            config.cacheUpload = false;
+        }
+        else if(string("--no-daemon") == argv[i])
+        {
+            // Only read by the client side of piled
+        }
+        else if(string("--target") == argv[i])
+        {
+            i++;
+            if(i >= argc)
+                break;
+            list<string> ls = ioExplode(argv[i], ',');
+            for(list<string>::iterator e = ls.begin(); e != ls.end(); e++)
+            {
+                if(*e != "")
+                    env.targets.push_back(*e);
+            }
+        }
         // Check for .pile file extension ('pile myfile.pile')
         else if(string("pile") == ioStripToExt(argv[i]))
         {
@@ -440,11 +539,16 @@ int main(int argc, char* argv[])
             //p
             string arg = argv[i];
             // FIXME: Replace this find() with a smarter one that takes quotes into account
-            unsigned int eq = arg.find("=");
+            string::size_type eq = arg.find("=");
             if(eq != string::npos && eq > 0)
             {
                 env.variables.insert(make_pair(arg.substr(0, eq), arg.substr(eq+1)));
             }
+            else if(arg != "" && arg[0] != '-')
+            {
+                // Something to build, like 'pile obj/foo.o'
+                env.targets.push_back(arg);
+            }
             else
             {
                 UI_warning("pile Warning: Command \"%s\" not found, so it will be ignored.\n", argv[i]);
@@ -464,6 +568,25 @@ int main(int argc, char* argv[])
 
     UI_debug_pile("Current directory: %s", ioGetCWD().c_str());
 
+    if(affected)
+    {
+        printAffected(changedFiles);
+        UI_quit();
+        return 0;
+    }
+    if(history > 0)
+    {
+        printHistory(history);
+        UI_quit();
+        return 0;
+    }
+    if(headerReport > 0)
+    {
+        printHeaderReport(headerReport);
+        UI_quit();
+        return 0;
+    }
+
 
     // Find the appropriate pilefile
     if(file == "")
@@ -481,42 +604,132 @@ int main(int argc, char* argv[])
         UI_processEvents();
         UI_updateScreen();
 
-        // Interpret the file
-        if(!interpret(file, env, config))
-            errorFlag = interpreterError = true;
-        UI_debug_pile("Done interpreting.\n");
+        if(env.mergeShards && !copyShardObjects(env.shardDirs, env.shardObjects))
+            errorFlag = true;
+
+        if(!cleaning)
+            setCacheServer(config.cache, config.cacheUpload && !env.dryRun);
+
+        if(config.changeDetection == "git" && !cleaning)
+            loadGitChanges();
+        else if(config.changeDetection != "stat")
+            UI_warning("pile Warning: Unknown change detection \"%s\", so every file will be checked.\n", config.changeDetection.c_str());
+
+        // Each variant that was asked for gets its own reading of the
+        // pilefile and its own object directory.  Their jobs all run
+        // together afterward.
+        list<string> variants = env.variants;
+        if(variants.size() == 0)
+            variants.push_back("");
+        Configuration baseConfig = config;
+        for(list<string>::iterator v = variants.begin(); v != variants.end() && !errorFlag; v++)
+        {
+            if(v != variants.begin())
+            {
+                interpreter.reset();
+                env.sources.clear();
+                env.objects.clear();
+                env.cflags.clear();
+                env.lflags.clear();
+                env.loadConfig(baseConfig);
+            }
+            config = baseConfig;
+            env.variants.clear();
+            if(*v != "")
+            {
+                UI_print("Variant: %s\n", v->c_str());
+                env.variants.push_back(*v);
+                config.variant = *v;
+                config.objPath = addDirSlash(config.objPath) + addDirSlash(*v);
+            }
 
-        UI_processEvents();
-        UI_updateScreen();
+            // Interpret the file
+            unsigned long phaseStart = getMilliseconds();
+            if(!interpret(file, env, config))
+                errorFlag = interpreterError = true;
+            addPhaseTime("Reading the pilefile", getMilliseconds() - phaseStart);
+            UI_debug_pile("Done interpreting.\n");
 
-        if(!errorFlag && env.sources.size() > 0)
-        {
-            // Scan for dependencies
-            if(config.useAutoDepend)
+            UI_processEvents();
+            UI_updateScreen();
+
+            if(!errorFlag && env.sources.size() > 0)
             {
-                UI_debug_pile("Scanning.\n");
-                for(list<string>::iterator e = env.sources.begin(); e != env.sources.end(); e++)
+                // Scan for dependencies
+                if(config.useAutoDepend)
                 {
-                    recurseIncludes(env.depends, env.fileDataHash, config.includePaths, *e, "");
-                    //if(!recurseIncludes(env.depends, env.fileDataHash, config.includePaths, *e, ""))
-                    //{
-                    //    errorFlag = true;
-                    //    break;
-                    //}
+                    UI_debug_pile("Scanning.\n");
+                    TraceScope scanning("Scanning includes", "scan");
+                    phaseStart = getMilliseconds();
+                    for(list<string>::iterator e = env.sources.begin(); e != env.sources.end(); e++)
+                    {
+                        recurseIncludes(env.depends, env.fileDataHash, config.includePaths, *e, "");
+                        //if(!recurseIncludes(env.depends, env.fileDataHash, config.includePaths, *e, ""))
+                        //{
+                        //    errorFlag = true;
+                        //    break;
+                        //}
+                    }
+                    addPhaseTime("Scanning", getMilliseconds() - phaseStart);
                 }
-            }
 
-            if(!env.dryRun && !cleaning && !errorFlag)
-            {
-                UI_debug_pile("Building and linking.\n");
-                if(!env.noCompile && !build(env, config))
-                    errorFlag = true;
-                if(!errorFlag)
-                    if(!env.noLink && !link(config.languages.find("CPP_LINKER_D")->second, env, config))
+                if(!env.dryRun && !cleaning && !errorFlag)
+                {
+                    UI_debug_pile("Building and linking.\n");
+                    if(!env.noCompile && !build(env, config))
                         errorFlag = true;
+                    if(!errorFlag)
+                        if(!env.noLink && !link(config.languages.find("CPP_LINKER_D")->second, env, config))
+                            errorFlag = true;
+                }
             }
         }
 
+        // Unity files that no compile() asked for are out of date.
+        if(!interpreterError && !cleaning)
+            removeStaleUnitySources(env.depends, env.fileDataHash);
+
+        // Run what the pilefile asked for.
+        if(!errorFlag && env.targets.size() > 0 && !selectTargets(env.targets))
+            errorFlag = true;
+        if(!errorFlag && env.shardCount > 0)
+        {
+            // The objects are linked by 'merge-shards'.
+            if(!selectShard(env.shard, env.shardCount, env.shardTimes))
+                errorFlag = true;
+        }
+        else if(!errorFlag && env.mergeShards && !checkShardsMerged(env.shardObjects))
+            errorFlag = true;
+        if(env.dryRun || env.emitNinja || cleaning || errorFlag)
+            clearJobs();
+        else
+        {
+            int jobs = (config.jobs > 0? config.jobs : getCPUCount());
+            UI_debug_pile("Running jobs, %d at a time.\n", jobs);
+            traceBegin("Running jobs", "jobs");
+            unsigned long phaseStart = getMilliseconds();
+            if(!runJobs(jobs, config.workers))
+                errorFlag = true;
+            addPhaseTime("Running jobs", getMilliseconds() - phaseStart);
+            traceEnd();
+        }
+
+        // Remember how the project fits together, for 'pile affected'.
+        if(!interpreterError && !cleaning && !env.dryRun && !env.emitNinja)
+            writeGraph(interpreter.filesRead, env.depends, env.fileDataHash);
+        if(env.emitNinja && !errorFlag)
+        {
+            // build.ninja is written again when any of these change.
+            list<string> buildFiles = interpreter.filesRead;
+            buildFiles.push_back(getConfigDir() + "pile.conf");
+            if(!writeNinja(file, buildFiles, vector<string>(argv + 1, argv + argc), env.depends, env.fileDataHash))
+                errorFlag = true;
+        }
+        saveGitState(env.fileDataHash);
+        saveCompileTimes();
+        if(!interpreterError && !cleaning && !env.dryRun && !env.emitNinja)
+            appendBuildHistory(!errorFlag);
+
     }
     else  // No Pilefile found
     {
@@ -591,6 +804,11 @@ int main(int argc, char* argv[])
 
 
 
+    if(showStats)
+        reportStats();
+    traceCompilerTiming();
+    writeTrace();
+
     if(errorFlag)
     {
         if(interpreterError)
@@ -624,5 +842,131 @@ int main(int argc, char* argv[])
 
     UI_quit();
 
-    return 0;
+    return (errorFlag? 1 : 0);
+}
+
+// Starts piled, which needs a pilefile to serve.
+int startDaemon(int argc, char* argv[])
+{
+    if((argc == 0 || string("stop") != argv[0]) && findPileFile() == "")
+    {
+        UI_error("pile error: piled has to be started in a Pilefile's directory.\n");
+        return 1;
+    }
+    return runDaemon(argc, argv, runPile);
+}
+
+// Starts 'pile watch', which needs a pilefile to build.
+int startWatch(int argc, char* argv[])
+{
+    if(findPileFile() == "")
+    {
+        UI_error("pile error: 'pile watch' has to be run in a Pilefile's directory.\n");
+        return 1;
+    }
+    return runWatch(argc, argv, runPile);
+}
+
+/*
+The basic outline:
+Create config file if it doesn't exist.
+Delete the old log file if it exists.
+
+
+*/
+int main(int argc, char* argv[])
+{
+    startStats();
+
+    //string pileDirectory = ioGetProgramPath();
+
+    // Create config dir
+    ioNewDir(getConfigDir());
+
+    // Set log file
+    string configDir = getConfigDir();
+    log_file = configDir + "pile_log.txt";
+    //log_file = "pile_log.txt";
+
+    // Delete log file
+    ioDelete(log_file);
+
+    UI_debug_pile("Starting up...\n");
+    UI_debug_pile("Argc = %d\n", argc);
+    for(int i = 0; i < argc; i++)
+    {
+        UI_debug_pile("Argv[%d] = %s\n", i, argv[i]);
+    }
+
+    // pile-worker is this same program under another name.
+    if(ioStripToFile(argv[0]).substr(0, 11) == "pile-worker")
+        return runWorker(argc - 1, argv + 1);
+    if(argc > 1 && string("worker") == argv[1])
+        return runWorker(argc - 2, argv + 2);
+    // Used by compile jobs that run on a worker
+    if(argc > 1 && string("remote-compile") == argv[1])
+        return remoteCompile(argc - 2, argv + 2);
+    // So is pile-cache-server.
+    if(ioStripToFile(argv[0]).substr(0, 17) == "pile-cache-server")
+        return runCacheServer(argc - 1, argv + 1);
+    if(argc > 1 && string("cache-server") == argv[1])
+        return runCacheServer(argc - 2, argv + 2);
+    // Used by jobs that look in the cache
+    if(argc > 1 && string("cache-fetch") == argv[1])
+        return runCacheFetch(argc - 2, argv + 2);
+
+    // A piled here already has everything loaded.
+    int daemonExitCode = 0;
+    if(canUseDaemon(argc, argv) && runOnDaemon(argc, argv, daemonExitCode))
+        return daemonExitCode;
+
+
+
+
+    // Load pile.conf
+    if(!ioExists(configDir))
+        ioNewDir(configDir);
+
+
+    // Loading pile.conf is traced too, but not for each build of piled or
+    // 'pile watch'.
+    for(int i = 1; i+1 < argc; i++)
+    {
+        if(string("--trace") == argv[i] && string("daemon") != argv[1] && string("watch") != argv[1])
+            startTrace(argv[i+1]);
+    }
+
+    UI_debug("Loading config.\n");
+    traceBegin("Loading pile.conf", "config");
+    unsigned long phaseStart = getMilliseconds();
+    loadConfig(configDir, config);
+    UI_debug("Done loading config.\n");
+
+    env.loadConfig(config);
+    addPhaseTime("Loading pile.conf", getMilliseconds() - phaseStart);
+    traceEnd();
+
+    if(config.installPath == "")
+    {
+        SYS_alert(("Pile's install path has not been set!  Please edit " + configDir + "pile.conf and set the PILE_PATH string to the directory that contains the Pile installation.\n").c_str());
+        return 0;
+    }
+    else
+    {
+        /*if(!ioExists(addDirSlash(config.installPath) + ioStripToFile(argv[0])))
+        {
+            UI_error(("Pile's install path has not been set!  Please edit " + configDir + "pile.conf and set the PILE_PATH string to the directory that contains the Pile installation.\n").c_str());
+            return 0;
+        }*/
+    }
+
+    // piled is this same program under another name.
+    if(ioStripToFile(argv[0]) == "piled")
+        return startDaemon(argc - 1, argv + 1);
+    if(argc > 1 && string("daemon") == argv[1])
+        return startDaemon(argc - 2, argv + 2);
+    if(argc > 1 && string("watch") == argv[1])
+        return startWatch(argc - 2, argv + 2);
+
+    return runPile(argc, argv);
 }
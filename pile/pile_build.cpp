@@ -14,16 +14,32 @@ added to the global scope of the interpreter.
 */
 
 #include "pile_global.h"
+#include "pile_cache.h"
 #include "pile_config.h"
 #include "pile_depend.h"
+#include "pile_graph.h"
 #include "pile_env.h"
 #include "pile_commands.h"
+#include "pile_compiler.h"
+#include "pile_jobs.h"
+#include "pile_linker.h"
+#include "pile_ninja.h"
+#include "pile_pch.h"
+#include "pile_shard.h"
+#include "pile_timing.h"
+#include "pile_trace.h"
+#include "pile_unity.h"
+#include "pile_worker.h"
 #include "string_functions.h"
+#include <algorithm>
+#include <set>
+#include <sstream>
 
 bool isCExt(const string& ext);
 bool isCPPExt(const string& ext);
 bool isFORTRANExt(const string& ext);
 string getBaseName(string file);
+string compileCacheKey(const string& path, const vector<string>& options, const string& sourceFile, FileData* fd);
 
 extern Environment env;
 extern Configuration config;
@@ -166,7 +182,7 @@ Returns: string (file extension)
 */
 string getExtension(const string& file)
 {
-    unsigned int dotpos = file.find_last_of(".");
+    string::size_type dotpos = file.find_last_of(".");
     if(dotpos != string::npos)
     {
         string ext = file.substr(dotpos, string::npos);
@@ -220,12 +236,404 @@ Variable* fn_scan(Variable* arg1, Variable* arg2)
         String* s = static_cast<String*>(*e);
         sourceFile = s->getValue();
 
+        TraceScope scanning("Scanning " + removeQuotes(sourceFile), "scan");
         recurseIncludes(env.depends, env.fileDataHash, config.includePaths, removeQuotes(sourceFile), "");
     }
 
     return NULL;
 }
 
+/*
+Gets the object file name for a source file.  Generated unity sources already
+live in the object directory, so their objects go right beside them.
+
+Takes: string (source file name)
+Returns: string (object file name)
+*/
+string objectName(const string& source)
+{
+    if(isUnitySource(source, config.objPath))
+        return getBaseName(source) + ".o";
+    return getObjectName(source, config.objPath, config.useSourceObjPath);
+}
+
+/*
+Rewrites relative include and library paths in a compiler option so that it
+still works when the compiler is run from another directory.  The paths stay
+relative, so the command is the same in every checkout.
+
+Takes: string (one or more whitespace-separated options)
+       string (directory the compiler is run from)
+Returns: string (the rewritten options)
+*/
+string optionPathsFromDir(const string& option, const string& dir)
+{
+    const char* prefixes[] = {"-I", "-L", "-isystem", "-iquote", "-idirafter", "-include-pch", "-include", "-imacros", NULL};
+    
+    string result;
+    bool pathNext = false;
+    list<string> words = ioExplode(option, ' ');
+    for(list<string>::iterator e = words.begin(); e != words.end(); e++)
+    {
+        string word = *e;
+        if(pathNext)
+        {
+            if(word != "" && word[0] != '/' && word[0] != '`' && word[0] != '$' && word[0] != '\"')
+                word = pathFromDir(dir, word);
+            pathNext = (word == "");
+        }
+        else
+        {
+            for(int i = 0; prefixes[i] != NULL; i++)
+            {
+                string prefix = prefixes[i];
+                if(word.substr(0, prefix.size()) != prefix)
+                    continue;
+                
+                if(word.size() == prefix.size())
+                    pathNext = true;
+                else if(prefix.size() == 2 || prefix == "-isystem" || prefix == "-iquote" || prefix == "-idirafter")
+                {
+                    string path = word.substr(prefix.size());
+                    if(path[0] != '/' && path[0] != '`' && path[0] != '$' && path[0] != '\"')
+                        word = prefix + pathFromDir(dir, path);
+                }
+                break;
+            }
+        }
+        
+        if(result != "")
+            result += " ";
+        result += word;
+    }
+    return result;
+}
+
+/*
+Gets the command which compiles a single source file.
+
+Takes: string (compiler path)
+       vector<string> (compiler options)
+       string (source file name)
+       string (object file name, quoted if necessary)
+Returns: string (the command)
+*/
+string compileCommand(const string& path, const vector<string>& options, const string& sourceFile, const string& objName)
+{
+    vector<string> args;
+    args.push_back(path);
+    args.insert(args.end(), options.begin(), options.end());
+    args.push_back("-c");
+    args.push_back(quoteWhitespace(sourceFile));
+    args.push_back("-o");
+    args.push_back(objName);
+
+    string buff = joinArgs(args);
+    convertSlashes(buff);
+    return buff;
+}
+
+// Compiles a single source file.
+class CompileJob : public Job
+{
+    public:
+    string path;
+    vector<string> options;
+    string sourceFile;
+    string objName;  // Quoted if necessary
+    string cacheKey;  // "" if the object is not cached
+    bool lookingUp;  // Whether the command looks in the cache
+    unsigned long startTime;
+    bool timed;  // Whether the compiler reports its time
+
+    CompileJob(const string& path, const vector<string>& options, const string& sourceFile, const string& objName, const string& cacheKey)
+        : path(path)
+        , options(options)
+        , sourceFile(sourceFile)
+        , objName(objName)
+        , cacheKey(cacheKey)
+        , lookingUp(cacheKey != "")
+        , startTime(0)
+        , timed(false)
+    {}
+
+    string start()
+    {
+        // The object may be a hard link to another variant's object.
+        ioDelete(removeQuotes(objName));
+        if(lookingUp)
+            return cacheFetchCommand(cacheKey, vector<string>(1, removeQuotes(objName)));
+        string buff = compileCommand(path, options, sourceFile, objName);
+        startTime = getMilliseconds();
+        if(worker != "")
+        {
+            UI_print(" Building %s on %s\n  %s\n", sourceFile.c_str(), worker.c_str(), buff.c_str());
+            return remoteCompileCommand(worker, buff);
+        }
+        UI_print(" Building %s\n  %s\n", sourceFile.c_str(), buff.c_str());
+        return buff;
+    }
+
+    bool canRunRemotely()
+    {
+        // A report written beside the object would stay on the worker.
+        return !lookingUp && !(timed && timingIsWrittenToFile(removeQuotes(path)));
+    }
+
+    bool showOutput(bool success)
+    {
+        return !lookingUp;
+    }
+
+    void readOutput(const string& outputFile, map<string, string>& details)
+    {
+        if(timed && !lookingUp)
+            readCompilerTiming(removeQuotes(path), list<string>(1, removeQuotes(objName)), outputFile, details);
+    }
+
+    bool finish(bool success)
+    {
+        if(lookingUp)
+        {
+            countCacheLookup(success);
+            if(success)
+            {
+                UI_print(" Downloaded %s from the cache\n", removeQuotes(objName).c_str());
+                return true;
+            }
+            // It wasn't there, so a copy of this job compiles it.
+            CompileJob* job = new CompileJob(*this);
+            job->lookingUp = false;
+            followUps.push_back(job);
+            return true;
+        }
+        if(success)
+        {
+            recordCompileTime(removeQuotes(objName), getMilliseconds() - startTime, true);
+            if(cacheKey != "")
+                uploadToCache(cacheKey, vector<string>(1, removeQuotes(objName)));
+        }
+        return success;
+    }
+
+    string getName()
+    {
+        // The history lists compiles by source.
+        if(lookingUp)
+            return sourceFile + " (cache lookup)";
+        return sourceFile;
+    }
+};
+
+/*
+Calls the compiler once for several source files whose objects all go into the
+same directory.  The compiler is run from inside that directory so that it puts
+the objects in the right place, with paths relative to it.  If the batch fails,
+each file gets its own CompileJob so that the errors are reported against the
+right source.
+*/
+class BatchJob : public Job
+{
+    public:
+    string path;
+    vector<string> options;
+    list<string> batch;
+    list<string> objNames;
+    string objDir;
+    bool allBuilt;
+    unsigned long startTime;
+    bool timed;  // Whether the compiler reports its time
+
+    BatchJob(const string& path, const vector<string>& options, const list<string>& batch, const string& objDir)
+        : path(path)
+        , options(options)
+        , batch(batch)
+        , objDir(objDir)
+        , allBuilt(false)
+        , startTime(0)
+        , timed(false)
+    {
+        for(list<string>::const_iterator e = batch.begin(); e != batch.end(); e++)
+            objNames.push_back(objectName(*e));
+    }
+
+    string start()
+    {
+        for(list<string>::iterator e = objNames.begin(); e != objNames.end(); e++)
+            ioDelete(*e);
+
+        vector<string> args;
+        args.push_back(path);
+        for(vector<string>::iterator e = options.begin(); e != options.end(); e++)
+            args.push_back(optionPathsFromDir(*e, objDir));
+        args.push_back("-c");
+        for(list<string>::const_iterator e = batch.begin(); e != batch.end(); e++)
+            args.push_back(quoteWhitespace(pathFromDir(objDir, *e)));
+
+        string buff = runInDirectory(objDir, joinArgs(args));
+        convertSlashes(buff);
+
+        UI_print(" Building %d files in %s\n  %s\n", batch.size(), objDir.c_str(), buff.c_str());
+        startTime = getMilliseconds();
+        return buff;
+    }
+
+    void readOutput(const string& outputFile, map<string, string>& details)
+    {
+        if(timed)
+            readCompilerTiming(removeQuotes(path), objNames, outputFile, details);
+    }
+
+    bool showOutput(bool success)
+    {
+        allBuilt = success;
+        for(list<string>::iterator e = objNames.begin(); allBuilt && e != objNames.end(); e++)
+        {
+            if(!ioExists(*e))
+                allBuilt = false;
+        }
+        // The files are built again one at a time if the batch failed.
+        return allBuilt;
+    }
+
+    bool finish(bool success)
+    {
+        if(allBuilt)
+        {
+            // Each file gets an even share of the time.
+            unsigned long share = (getMilliseconds() - startTime) / objNames.size();
+            for(list<string>::iterator e = objNames.begin(); e != objNames.end(); e++)
+                recordCompileTime(*e, share);
+            return true;
+        }
+
+        // Find out which files are to blame.  The jobs run alongside the
+        // rest of the build, and what needs the batch waits for them.
+        UI_print(" Batch failed.  Building its files one at a time.\n");
+        list<string>::iterator o = objNames.begin();
+        for(list<string>::iterator e = batch.begin(); e != batch.end(); e++, o++)
+        {
+            CompileJob* job = new CompileJob(path, options, *e, quoteWhitespace(*o), compileCacheKey(path, options, *e, env.fileDataHash[*e]));
+            job->timed = timed;
+            followUps.push_back(job);
+        }
+        return true;
+    }
+
+    string getName()
+    {
+        return objDir;
+    }
+};
+
+// Puts an object that another job builds at one more path.
+class HardLinkJob : public Job
+{
+    public:
+    string source;
+    string dest;
+    bool linked;
+
+    HardLinkJob(const string& source, const string& dest)
+        : source(source)
+        , dest(dest)
+        , linked(false)
+    {}
+
+    string start()
+    {
+        UI_debug_pile("Linking %s to %s\n", dest.c_str(), source.c_str());
+        linked = hardLink(source, dest);
+        if(!linked)
+            UI_error("Could not make %s from %s.\n", dest.c_str(), source.c_str());
+        return "";
+    }
+
+    bool finish(bool success)
+    {
+        return linked;
+    }
+
+    string getName()
+    {
+        return dest;
+    }
+};
+
+// Objects that are being built, by the signature of their compile
+map<string, string> compileSignatures;
+
+/*
+Gets the signature of a compile: the compiler, the options, the source, and
+the times of everything it includes.  Compiles with the same signature make
+the same object.
+
+Takes: string (compiler path)
+       vector<string> (compiler options)
+       string (source file name)
+       FileData* (source file data, or NULL)
+Returns: string (signature)
+*/
+string compileSignature(const string& path, const vector<string>& options, const string& sourceFile, FileData* fd)
+{
+    string result = path + "\n" + joinArgs(options) + "\n" + sourceFile + "\n";
+
+    vector<string> fingerprint;
+    if(fd != NULL)
+    {
+        set<FileData*> depends;
+        collectDepends(env.depends, fd, depends);
+        for(set<FileData*>::iterator e = depends.begin(); e != depends.end(); e++)
+        {
+            stringstream str;
+            str << (*e)->getPath() << " " << (*e)->getTime();
+            fingerprint.push_back(str.str());
+        }
+    }
+    sort(fingerprint.begin(), fingerprint.end());
+    string text;
+    for(vector<string>::iterator e = fingerprint.begin(); e != fingerprint.end(); e++)
+        text += *e + "\n";
+    return result + hashToString(hashString(text));
+}
+
+/*
+Gets the key of a compile in the build cache.  It is like the signature, but
+uses the contents of the files instead of their times and the compiler's
+identity as well as its path, and paths inside the project are made relative,
+so that other machines and other checkouts get the same key.
+
+Takes: string (compiler path)
+       vector<string> (compiler options)
+       string (source file name)
+       FileData* (source file data, or NULL)
+Returns: string (key, or "" if no cache is used)
+*/
+string compileCacheKey(const string& path, const vector<string>& options, const string& sourceFile, FileData* fd)
+{
+    if(!usingCache())
+        return "";
+    string root = ioGetCWD();
+    string text = "compile\n" + path + " " + compilerIdentity(path) + "\n" + mapPathPrefix(root, joinArgs(options)) + "\n";
+    text += relativeToDir(root, sourceFile) + " " + fileHash(sourceFile) + "\n";
+
+    vector<string> fingerprint;
+    if(fd != NULL)
+    {
+        set<FileData*> depends;
+        collectDepends(env.depends, fd, depends);
+        for(set<FileData*>::iterator e = depends.begin(); e != depends.end(); e++)
+            fingerprint.push_back(relativeToDir(root, (*e)->getPath()) + " " + fileHash((*e)->getPath()));
+    }
+    sort(fingerprint.begin(), fingerprint.end());
+    for(vector<string>::iterator e = fingerprint.begin(); e != fingerprint.end(); e++)
+        text += *e + "\n";
+    return textHash(text);
+}
+
+// Compilers that were already found to lack -ffile-prefix-map
+set<string> warnedPrefixMap;
+
 // Returns array<string> objectFiles
 // Takes ClassObject compiler, array<string> sourceFiles, array<string> options
 Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3)
@@ -240,7 +648,33 @@ Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3)
     string path = quoteWhitespace(static_cast<String*>(c->getVariable("path"))->getValue());
     vector<Variable*> sourceFiles = sources->getValue();
 
-    string options;
+    int batchSize = 0;
+    Variable* batchVar = c->getVariable("batch_size");
+    if(batchVar != NULL && batchVar->getType() == INT)
+        batchSize = static_cast<Int*>(batchVar)->getValue();
+
+    int unitySize = 0;
+    Variable* unityVar = c->getVariable("unity");
+    if(unityVar != NULL && unityVar->getType() == INT)
+        unitySize = static_cast<Int*>(unityVar)->getValue();
+
+    bool usePCH = false;
+    Variable* pchVar = c->getVariable("pch");
+    if(pchVar != NULL && pchVar->getType() == BOOL)
+        usePCH = static_cast<Bool*>(pchVar)->getValue();
+
+    int pchStableAge = PILE_PCH_STABLE_AGE;
+    Variable* stableVar = c->getVariable("pch_stable_age");
+    if(stableVar != NULL && stableVar->getType() == INT)
+        pchStableAge = static_cast<Int*>(stableVar)->getValue();
+
+    bool timed = false;
+    Variable* timingVar = c->getVariable("timing");
+    if(timingVar != NULL && timingVar->getType() == BOOL)
+        timed = static_cast<Bool*>(timingVar)->getValue();
+
+    string cwd = ioGetCWD();
+    vector<string> options;
     for(vector<Variable*>::iterator e = opts->getValue().begin(); e != opts->getValue().end(); e++)
     {
         if((*e)->getType() != STRING)
@@ -249,21 +683,47 @@ Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3)
             return NULL;
         }
         String* s = static_cast<String*>(*e);
-        options += s->getValue() + " ";
+        options.push_back(s->getValue());
+    }
+
+    // Objects from another checkout should not hold its paths, like in their
+    // debug info, or they would not match what is built here.
+    // Older versions don't have the option.
+    if(usingCache() && getCompilerFamily(removeQuotes(path)) != COMPILER_UNKNOWN)
+    {
+        string prefixMap = quoteWhitespace("-ffile-prefix-map=" + cwd + "=.");
+        if(compilerAccepts(path, prefixMap))
+            options.push_back(prefixMap);
+        else if(warnedPrefixMap.insert(path).second)
+            UI_warning("Warning: %s does not take -ffile-prefix-map, so its objects hold the path of this checkout and only match ones built here.\n", removeQuotes(path).c_str());
+    }
+
+    // The compiler reports where its time goes.
+    if(timed)
+    {
+        string timingOption = compilerTimingOption(removeQuotes(path));
+        if(timingOption == "")
+        {
+            UI_warning("Warning: Pile can't read the compile times that %s reports.  Building without timing.\n", removeQuotes(path).c_str());
+            timed = false;
+        }
+        else
+        {
+            options.push_back(timingOption);
+        }
     }
 
     Array* resultObjects = new Array("<temp>", STRING);
 
 
-    char buffer[5000];
     string objName;
-    string sourceFile, sourceFileQuoted;
-    string tempname = ".pile.tmp";
-    list<string> failedFiles;
-    ioDelete(tempname.c_str());
+    string sourceFile;
+    // Sources waiting to be batched, keyed by object directory and extra
+    // options
+    map<pair<string, string>, list<string> > batches;
+    map<string, string> signatures;
 
-    UI_debug_pile("Checking sources for building.\n");
-    //UI_debug_pile("Sources size: %d\n", env.sources.size());
+    list<string> sourceNames;
     for(vector<Variable*>::iterator e = sourceFiles.begin(); e != sourceFiles.end(); e++)
     {
         if((*e)->getType() != STRING)
@@ -280,61 +740,97 @@ Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3)
             UI_error("Source file \"%s\" not found.\n", sourceFile.c_str());
             continue;
         }
-        sourceFileQuoted = quoteWhitespace(sourceFile);
+        sourceNames.push_back(sourceFile);
+    }
+
+    if(unitySize > 1)
+        sourceNames = makeUnitySources(sourceNames, unitySize, config.objPath, env.depends, env.fileDataHash);
+
+    // Extra options for each source, like the precompiled header, and the
+    // precompiled header that its job waits for
+    map<string, string> extraOptions;
+    map<string, string> pchFiles;
+    if(usePCH)
+        extraOptions = makePrecompiledHeaders(path, joinArgs(options), sourceNames, config.objPath, env.depends, env.fileDataHash, pchStableAge, pchFiles);
+
+    // The compiling is done later by runJobs(), so that everything in the
+    // pilefile (and every variant) shares the processors.
+    UI_debug_pile("Checking sources for building.\n");
+    //UI_debug_pile("Sources size: %d\n", env.sources.size());
+    for(list<string>::iterator e = sourceNames.begin(); e != sourceNames.end(); e++)
+    {
+        sourceFile = *e;
         //sourceFile = quoteWhitespace(*e);
         FileData* fd = env.fileDataHash[sourceFile];
-        objName = getObjectName(sourceFile, config.objPath, config.useSourceObjPath);
+        objName = objectName(sourceFile);
         mkpath(ioStripToDir(objName));
+        string objDir = ioStripToDir(objName);
+        string objFile = objName;
         objName = quoteWhitespace(objName);
         //objName = quoteWhitespace(sourceFile + ".o");
+        bool batched = false;
 
-
-        // FIXME: mustRebuild() is crashing... Is it fixed yet?
-        if(mustRebuild(removeQuotes(objName), env.depends, fd))
+        // Ninja does every compile itself, even the ones that are up to date.
+        if(env.emitNinja)
         {
-            sprintf(buffer, "%s %s -c %s -o %s", path.c_str(), options.c_str(), sourceFileQuoted.c_str(), objName.c_str());
-
-
-            string buff = buffer;
-            convertSlashes(buff);
-
-            UI_print(" Building %s\n  %s\n", sourceFile.c_str(), buff.c_str());
-
-
-            UI_debug_pile("Actual call:\n %s\n", buff.c_str());
-
-            // Needed for success check
-            /*bool objExists = ioExists(objName);
-            time_t objTime = 0;
-            if(objExists)
-                objTime = ioTimeModified(objName);*/
-
-            int result = systemCall(buff.c_str());
+            vector<string> sourceOptions = options;
+            sourceOptions.push_back(extraOptions[sourceFile]);
+            recordNinjaCompile(sourceFile, objFile, compileCommand(path, sourceOptions, sourceFile, objName), getCompilerFamily(removeQuotes(path)) != COMPILER_UNKNOWN, pchFiles[sourceFile]);
+        }
 
-            UI_print_file(tempname);
-            ioDelete(tempname.c_str());
-			
-			if(result != 0)
-				failedFiles.push_back(sourceFile);
+        bool rebuild = false;
+        if(getProducer(objFile) == NULL)
+        {
+            TraceScope checking("Checking " + objFile, "check");
+            rebuild = mustRebuild(objFile, env.depends, fd);
+        }
 
-            // Check to see if the build was successful.
-            /*if(objExists)
+        if(getProducer(objFile) != NULL)
+        {
+            // Already being built by an earlier compile().
+        }
+        // FIXME: mustRebuild() is crashing... Is it fixed yet?
+        else if(rebuild)
+        {
+            string extra = extraOptions[sourceFile];
+            vector<string> sourceOptions = options;
+            sourceOptions.push_back(extra);
+            string signature = compileSignature(path, sourceOptions, sourceFile, fd);
+            map<string, string>::iterator same = compileSignatures.find(signature);
+            if(same != compileSignatures.end())
             {
-                // FIXME: This looks like it could fail if the build is quick (and the object had been modified...)!!!
-                if(!ioExists(objName) || objTime >= ioTimeModified(objName))
-                    failedFiles.push_back(sourceFile);
-
+                // Another variant or target builds the very same object.
+                UI_print(" Same as %s: %s\n", same->second.c_str(), objFile.c_str());
+                Job* job = new HardLinkJob(same->second, objFile);
+                job->dependOn(same->second);
+                addJob(job);
+                setProducer(objFile, job);
+            }
+            else if(batchSize > 1)
+            {
+                batches[make_pair(objDir, extra)].push_back(sourceFile);
+                signatures[sourceFile] = signature;
+                batched = true;
             }
             else
             {
-                if(!ioExists(objName))
-                    failedFiles.push_back(sourceFile);
-            }*/
+                CompileJob* job = new CompileJob(path, sourceOptions, sourceFile, objName, compileCacheKey(path, sourceOptions, sourceFile, fd));
+                job->timed = timed;
+                job->dependOn(pchFiles[sourceFile]);
+                addJob(job);
+                setProducer(objFile, job);
+                compileSignatures[signature] = objFile;
+            }
         }
         else
         {
             UI_print(" Up to date: %s\n", sourceFile.c_str());
+            addTargetName(objFile, NULL);
         }
+        // Batches are made below.
+        if(!batched)
+            addTargetName(sourceFile, getProducer(objFile));
+        recordCompile(sourceFile, objFile);
 
         resultObjects->push_back(new String("<temp>", objName));
 
@@ -343,98 +839,986 @@ Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3)
         UI_updateScreen();
     }
 
-    if(failedFiles.size() > 0)
+    // Make the batches.  Two sources with the same base name would clobber
+    // each other's object, so they go into separate batches.
+    for(map<pair<string, string>, list<string> >::iterator e = batches.begin(); e != batches.end(); e++)
     {
-        UI_error("Some files failed to build:\n");
-        for(list<string>::iterator e = failedFiles.begin(); e != failedFiles.end(); e++)
+        const string& objDir = e->first.first;
+        vector<string> sourceOptions = options;
+        sourceOptions.push_back(e->first.second);
+        list<string>& waiting = e->second;
+        while(waiting.size() > 0)
         {
-            UI_error("  %s\n", e->c_str());
+            list<string> batch;
+            list<string> baseNames;
+            for(list<string>::iterator f = waiting.begin(); f != waiting.end() && int(batch.size()) < batchSize;)
+            {
+                string base = getBaseName(ioStripToFile(*f));
+                if(find(baseNames.begin(), baseNames.end(), base) != baseNames.end())
+                {
+                    f++;
+                    continue;
+                }
+                baseNames.push_back(base);
+                batch.push_back(*f);
+                f = waiting.erase(f);
+            }
+
+            Job* job;
+            if(batch.size() == 1)
+            {
+                CompileJob* compileJob = new CompileJob(path, sourceOptions, batch.front(), quoteWhitespace(objectName(batch.front())), compileCacheKey(path, sourceOptions, batch.front(), env.fileDataHash[batch.front()]));
+                compileJob->timed = timed;
+                job = compileJob;
+            }
+            else
+            {
+                BatchJob* batchJob = new BatchJob(path, sourceOptions, batch, objDir);
+                batchJob->timed = timed;
+                job = batchJob;
+            }
+            for(list<string>::iterator f = batch.begin(); f != batch.end(); f++)
+                job->dependOn(pchFiles[*f]);
+            addJob(job);
+            for(list<string>::iterator f = batch.begin(); f != batch.end(); f++)
+            {
+                setProducer(objectName(*f), job);
+                addTargetName(*f, job);
+                compileSignatures[signatures[*f]] = objectName(*f);
+            }
         }
-        UI_error("\n");
-        // FIXME: I have to make a better way to signal an error.
-        resultObjects->setValue(vector<Variable*>());
     }
 
     return resultObjects;
 }
 
 
-// Returns VOID (NULL)
-// Params: ClassObject linker, string outfile, array objects, array libraries, array options
-Variable* fn_link(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4, Variable* arg5)
+/*
+Gets where an output (like a program or library) of the variant being built
+goes.  Each variant asked for on the command line gets its own directory beside
+the output, so that the variants do not overwrite each other.
+
+Takes: string (output file name, as given in the pilefile)
+Returns: string (output file name for this variant)
+*/
+string variantOutputName(const string& outname)
 {
-    ClassObject* c = convertArg_ClassObject(arg1, "Linker");
-    String* outname = convertArg_String(arg2);
-    Array* objs = convertArg_Array(arg3, STRING);
-    Array* libs = convertArg_Array(arg4, STRING);
-    Array* opts = convertArg_Array(arg5, STRING);
+    if(config.variant == "" || outname == "" || outname[0] == '/')
+        return outname;
 
-    if(c == NULL || outname == NULL || objs == NULL || opts == NULL)
-        return NULL;
-    
+    string dir = ioStripToDir(outname);
+    if(dir == "")
+        return addDirSlash(config.variant) + outname;
+    return addDirSlash(dir) + addDirSlash(config.variant) + ioStripToFile(outname);
+}
+
+/*
+Gets the name of a file in the object directory that belongs to an output.
+It is named after the output's whole path in the project, with each / made
+into _, so that outputs with the same name in different directories (like
+tools/foo and tests/foo) don't share it.
+
+Takes: string (object directory)
+       string (output file name)
+       string (extension, with its dot)
+Returns: string (file name)
+*/
+string outputSideFile(const string& objPath, const string& outname, const string& ext)
+{
+    string name = relativeToDir(ioGetCWD(), absolutePath(outname));
+    for(string::size_type i = 0; i < name.size(); i++)
+    {
+        if(name[i] == '/' || name[i] == '\\')
+            name[i] = '_';
+    }
+    return addDirSlash(objPath) + name + ext;
+}
+
+/*
+Writes the arguments into a response file (read by the linker as @file) in the
+object directory.  The file is only rewritten when the arguments change.
+
+Takes: string (object directory)
+       string (output file name, used to name the response file)
+       vector<string> (arguments, quoted if necessary)
+Returns: string (response file name)
+*/
+string writeResponseFile(const string& objPath, const string& outname, const vector<string>& args)
+{
+    string file = outputSideFile(objPath, outname, ".rsp");
+    mkpath(objPath);
+
+    string text;
+    for(vector<string>::const_iterator e = args.begin(); e != args.end(); e++)
+        text += *e + "\n";
+
+    if(writeIfChanged(file, text))
+        UI_debug_pile("Wrote response file %s\n", file.c_str());
+    return file;
+}
+
+// Gets the text of a manifest which remembers how an output was made.
+string makeManifest(const string& command, const vector<string>& members)
+{
+    string manifest = command + "\n";
+    for(vector<string>::const_iterator e = members.begin(); e != members.end(); e++)
+        manifest += *e + "\n";
+    return manifest;
+}
+
+/*
+Checks an output that is made from a list of members (like an archive) against
+the manifest that was written along with it.  The manifest holds the command
+and the member names.
+
+Takes: string (output file name)
+       string (manifest file name)
+       string (command that makes the output)
+       vector<string> (member file names)
+       vector<string> (members that changed since the output was made are
+                       added here)
+Returns: true if the output exists and was made by the same command from the
+         same members
+         false if it has to be made over
+*/
+bool findChangedMembers(const string& out, const string& manifestFile, const string& command, const vector<string>& members, vector<string>& changed)
+{
+    if(!ioExists(out) || readFile(manifestFile) != makeManifest(command, members))
+        return false;
+
+    time_t outTime = ioTimeModified(out);
+    for(vector<string>::const_iterator e = members.begin(); e != members.end(); e++)
+    {
+        if(!ioExists(*e) || ioTimeModified(*e) >= outTime)
+            changed.push_back(*e);
+    }
+    return true;
+}
+
+/*
+Partially links (ld -r) the objects of one directory into one intermediate
+object in obj/partial/.  The intermediate is only linked again when one of its
+objects changes.  If it fails, the final link takes the objects as they are.
+*/
+class PartialLinkJob : public Job
+{
+    public:
+    string path;
+    string dir;
+    vector<string> members;
+    string objPath;
+    string partial;
+    string manifestFile;
+    bool linkDirectly;  // True if the final link must take the members instead
+
+    PartialLinkJob(const string& path, const string& dir, const vector<string>& members, const string& objPath, const string& partial)
+        : path(path)
+        , dir(dir)
+        , members(members)
+        , objPath(objPath)
+        , partial(partial)
+        , manifestFile(partial + ".members")
+        , linkDirectly(false)
+    {}
+
+    string getCommand()
+    {
+        vector<string> command;
+        command.push_back(path);
+        command.push_back("-r -nostdlib");
+        return joinArgs(command);
+    }
+
+    vector<string> getMemberArgs()
+    {
+        vector<string> result;
+        for(vector<string>::iterator e = members.begin(); e != members.end(); e++)
+            result.push_back(quoteWhitespace(*e));
+        return result;
+    }
+
+    string start()
+    {
+        vector<string> changed;
+        if(findChangedMembers(partial, manifestFile, getCommand(), members, changed) && changed.size() == 0)
+        {
+            UI_debug_pile(" Up to date: %s\n", partial.c_str());
+            return "";
+        }
+
+        mkpath(ioStripToDir(partial));
+        vector<string> memberArgs = getMemberArgs();
+        unsigned int memberLength = 0;
+        for(vector<string>::iterator e = memberArgs.begin(); e != memberArgs.end(); e++)
+            memberLength += e->size() + 1;
+
+        vector<string> args;
+        args.push_back(getCommand());
+        args.push_back("-o");
+        args.push_back(quoteWhitespace(partial));
+        if(memberLength > PILE_MAX_COMMAND_LENGTH)
+            args.push_back("@" + quoteWhitespace(writeResponseFile(objPath, partial, memberArgs)));
+        else
+            args.insert(args.end(), memberArgs.begin(), memberArgs.end());
+
+        string buff = joinArgs(args);
+        UI_print(" Partial link of %d objects in %s\n  %s\n", members.size(), (dir == ""? "." : dir.c_str()), buff.c_str());
+        convertSlashes(buff);
+        return buff;
+    }
+
+    bool finish(bool success)
+    {
+        if(!success || !ioExists(partial))
+        {
+            UI_warning("Warning: Partial link failed.  Linking the objects in %s directly.\n", dir.c_str());
+            ioDelete(partial.c_str());
+            ioDelete(manifestFile.c_str());
+            linkDirectly = true;
+            return true;
+        }
+
+        writeIfChanged(manifestFile, makeManifest(getCommand(), members));
+        return true;
+    }
+
+    string getName()
+    {
+        return partial;
+    }
+};
+
+/*
+Groups the objects by directory for incremental linking.  Each directory with
+more than one object gets a partial link job.
+
+Takes: string (linker path)
+       vector<string> (object file names, quoted if necessary)
+       vector<string> (the objects or intermediates for the final link, in
+                       order, are put here)
+       vector<PartialLinkJob*> (the job that makes each of those, or NULL, is
+                                put here)
+*/
+void partialLink(const string& path, const vector<string>& objects, vector<string>& result, vector<PartialLinkJob*>& partialJobs)
+{
+    vector<string> dirs;
+    map<string, vector<string> > groups;
+    for(vector<string>::const_iterator e = objects.begin(); e != objects.end(); e++)
+    {
+        string dir = ioStripToDir(removeQuotes(*e));
+        if(groups.find(dir) == groups.end())
+            dirs.push_back(dir);
+        groups[dir].push_back(removeQuotes(*e));
+    }
+
+    string partialDir = addDirSlash(config.objPath) + "partial/";
+    for(vector<string>::iterator d = dirs.begin(); d != dirs.end(); d++)
+    {
+        vector<string>& members = groups[*d];
+        if(members.size() < 2)
+        {
+            result.push_back(quoteWhitespace(members.front()));
+            partialJobs.push_back(NULL);
+            continue;
+        }
+
+        string name = *d;
+        string objDir = addDirSlash(config.objPath);
+        if(name.substr(0, objDir.size()) == objDir)
+            name = name.substr(objDir.size());
+        for(unsigned int i = 0; i < name.size(); i++)
+        {
+            if(name[i] == '/' || name[i] == '\\' || name[i] == ':' || name[i] == ' ')
+                name[i] = '_';
+        }
+        if(name == "" || name == ".")
+            name = "_";
+        string partial = partialDir + name + ".o";
+
+        PartialLinkJob* job = new PartialLinkJob(path, *d, members, config.objPath, partial);
+        for(vector<string>::iterator e = members.begin(); e != members.end(); e++)
+            job->dependOn(*e);
+        addJob(job);
+        setProducer(partial, job);
+
+        result.push_back(quoteWhitespace(partial));
+        partialJobs.push_back(job);
+    }
+}
+
+// Links a program or library.
+class LinkJob : public Job
+{
+    public:
+    string path;  // Quoted if necessary
+    string outfile;
+    string historyName;
+    string objPath;
+    vector<string> objects;
+    vector<PartialLinkJob*> partialJobs;
+    vector<string> options;
+    vector<string> libraries;
+    vector<string> madeLibraries;  // Libraries that this build makes
+    string requested;
+    string backend;
+    string failedBackend;
+    unsigned long startTime;
+    bool upToDate;
+    string manifestFile;
+    string cacheKey;
+    bool triedCache;
+    bool lookingUp;  // Whether the command looks in the cache
+
+    LinkJob(const string& path, const string& outfile, const string& objPath, const vector<string>& options, const vector<string>& libraries, const vector<string>& madeLibraries, const string& requested)
+        : path(path)
+        , outfile(outfile)
+        , objPath(objPath)
+        , options(options)
+        , libraries(libraries)
+        , madeLibraries(madeLibraries)
+        , requested(requested)
+        , startTime(0)
+        , upToDate(false)
+        , triedCache(false)
+        , lookingUp(false)
+    {
+        historyName = outfile;
+        if(historyName[0] != '/')
+            historyName = addDirSlash(ioGetCWD()) + historyName;
+        manifestFile = outputSideFile(objPath, outfile, ".link");
+    }
+
+    // Gets what the output is made from, for the manifest.  The backend is
+    // left out, since it does not change the output.
+    vector<string> getMembers()
+    {
+        vector<string> result;
+        for(vector<string>::iterator e = objects.begin(); e != objects.end(); e++)
+            result.push_back(removeQuotes(*e));
+        result.insert(result.end(), madeLibraries.begin(), madeLibraries.end());
+        return result;
+    }
+
+    string getManifestCommand()
+    {
+        vector<string> args;
+        args.push_back(path);
+        args.insert(args.end(), options.begin(), options.end());
+        args.insert(args.end(), libraries.begin(), libraries.end());
+        return joinArgs(args);
+    }
+
+    // Gets the key of this link in the build cache, from the command and the
+    // contents of what is linked.
+    string getCacheKey()
+    {
+        string root = ioGetCWD();
+        string text = "link\n" + compilerIdentity(path) + "\n" + mapPathPrefix(root, getManifestCommand()) + "\n" + relativeToDir(root, outfile) + "\n";
+        vector<string> members = getMembers();
+        for(vector<string>::iterator e = members.begin(); e != members.end(); e++)
+            text += relativeToDir(root, *e) + " " + fileHash(*e) + "\n";
+        return textHash(text);
+    }
+
+    string getCommand()
+    {
+        // Intermediates that failed are replaced by their objects.
+        vector<string> objectArgs;
+        for(unsigned int i = 0; i < objects.size(); i++)
+        {
+            if(partialJobs[i] != NULL && partialJobs[i]->linkDirectly)
+            {
+                vector<string> memberArgs = partialJobs[i]->getMemberArgs();
+                objectArgs.insert(objectArgs.end(), memberArgs.begin(), memberArgs.end());
+            }
+            else
+                objectArgs.push_back(objects[i]);
+        }
+
+        unsigned int objectLength = 0;
+        for(vector<string>::iterator e = objectArgs.begin(); e != objectArgs.end(); e++)
+            objectLength += e->size() + 1;
+
+        vector<string> args;
+        args.push_back(path);
+        // Threaded backends get the processors that nothing else is using.
+        vector<string> backendOptions = linkerBackendOptions(backend, getFreeJobSlots());
+        args.insert(args.end(), backendOptions.begin(), backendOptions.end());
+        args.push_back("-o");
+        args.push_back(quoteWhitespace(outfile));
+        if(objectLength > PILE_MAX_COMMAND_LENGTH)
+            args.push_back("@" + quoteWhitespace(writeResponseFile(objPath, outfile, objectArgs)));
+        else
+            args.insert(args.end(), objectArgs.begin(), objectArgs.end());
+        args.insert(args.end(), options.begin(), options.end());
+        args.insert(args.end(), libraries.begin(), libraries.end());
+
+        string buff = joinArgs(args);
+        UI_print("Linking: %s\n", buff.c_str());
+        convertSlashes(buff);
+        return buff;
+    }
+
+    string start()
+    {
+        // Switching between variants should not link them over again.
+        vector<string> changed;
+        bool failedPartial = false;
+        for(vector<PartialLinkJob*>::iterator e = partialJobs.begin(); e != partialJobs.end(); e++)
+        {
+            if(*e != NULL && (*e)->linkDirectly)
+                failedPartial = true;
+        }
+        if(!failedPartial && findChangedMembers(outfile, manifestFile, getManifestCommand(), getMembers(), changed) && changed.size() == 0)
+        {
+            UI_print(" Up to date: %s\n", outfile.c_str());
+            upToDate = true;
+            return "";
+        }
+        ioDelete(manifestFile.c_str());
+
+        mkpath(ioStripToDir(outfile));
+        if(!failedPartial && usingCache() && !triedCache)
+        {
+            triedCache = true;
+            lookingUp = true;
+            cacheKey = getCacheKey();
+            return cacheFetchCommand(cacheKey, vector<string>(1, outfile));
+        }
+        // Use a faster linker backend (like mold or lld) if the driver can.
+        // A retry after a backend failed keeps the default linker.
+        if(usesLinkerBackends(removeQuotes(path)) && failedBackend == "")
+            backend = chooseLinkerBackend(requested, historyName);
+
+        startTime = getMilliseconds();
+        return getCommand();
+    }
+
+    bool showOutput(bool success)
+    {
+        return !lookingUp;
+    }
+
+    bool finish(bool success)
+    {
+        if(upToDate)
+            return true;
+        if(lookingUp)
+        {
+            countCacheLookup(success);
+            if(success)
+            {
+                UI_print(" Downloaded %s from the cache\n", outfile.c_str());
+                mkpath(objPath);
+                writeIfChanged(manifestFile, makeManifest(getManifestCommand(), getMembers()));
+                return true;
+            }
+            // It wasn't there, so a copy of this job links it.
+            LinkJob* job = new LinkJob(*this);
+            job->lookingUp = false;
+            followUps.push_back(job);
+            return true;
+        }
+        if(success)
+        {
+            if(backend != "")
+                recordLinkTime(backend, historyName, getMilliseconds() - startTime);
+            // Only blame the backend if the default linker did better.
+            if(failedBackend != "")
+                recordFailedLink(failedBackend, historyName);
+            mkpath(objPath);
+            writeIfChanged(manifestFile, makeManifest(getManifestCommand(), getMembers()));
+            if(cacheKey != "")
+                uploadToCache(cacheKey, vector<string>(1, outfile));
+            return true;
+        }
+
+        if(requested == "auto" && backend != "" && backend != "default")
+        {
+            // A copy of this job tries the default linker, and what needs
+            // the output waits for it.
+            UI_warning("Warning: Linking with %s failed.  Trying the default linker.\n", backend.c_str());
+            LinkJob* job = new LinkJob(*this);
+            job->failedBackend = backend;
+            job->backend = "default";
+            followUps.push_back(job);
+            return true;
+        }
+
+        UI_error("Linking failed.\n");
+        return false;
+    }
+
+    string getName()
+    {
+        if(lookingUp)
+            return outfile + " (cache lookup)";
+        return outfile;
+    }
+};
+
+/*
+Adds a job which links an output (a program or a shared library).
+
+Takes: ClassObject* (linker)
+       string (output file name, as given in the pilefile)
+       Array* (object file names)
+       Array* (libraries)
+       Array* (linker options)
+*/
+void linkOutput(ClassObject* c, const string& outname, Array* objs, Array* libs, Array* opts)
+{
     if(objs->size() == 0)
-        return NULL;
+        return;
 
     string path = quoteWhitespace(static_cast<String*>(c->getVariable("path"))->getValue());
     vector<Variable*> objects = objs->getValue();
 
-    string options;
+    vector<string> options;
     for(vector<Variable*>::iterator e = opts->getValue().begin(); e != opts->getValue().end(); e++)
     {
         if((*e)->getType() != STRING)
         {
             interpreter.error("Wrong type in array sent to build().\n");
-            return NULL;
+            return;
         }
         String* s = static_cast<String*>(*e);
-        options += s->getValue() + " ";
+        options.push_back(s->getValue());
     }
 
-    string libraries;
+    // Libraries made by this build are found in the variant's directory.
+    vector<string> libraries;
+    vector<string> madeLibraries;
     for(vector<Variable*>::iterator e = libs->getValue().begin(); e != libs->getValue().end(); e++)
     {
         if((*e)->getType() != STRING)
         {
             interpreter.error("Wrong type in array sent to build().\n");
-            return NULL;
+            return;
         }
         String* s = static_cast<String*>(*e);
-        libraries += s->getValue() + " ";
+        string library = variantOutputName(removeQuotes(s->getValue()));
+        if(getProducer(library) != NULL)
+        {
+            libraries.push_back(quoteWhitespace(library));
+            madeLibraries.push_back(library);
+        }
+        else
+            libraries.push_back(s->getValue());
     }
 
-    string objectstr;
+    vector<string> objectArgs;
     for(vector<Variable*>::iterator e = objects.begin(); e != objects.end(); e++)
     {
         if((*e)->getType() != STRING)
         {
             interpreter.error("Wrong type in array sent to build().\n");
+            return;
+        }
+        String* s = static_cast<String*>(*e);
+        objectArgs.push_back(quoteWhitespace(s->getValue()));
+    }
+
+    string requested = "default";
+    Variable* backendVar = c->getVariable("backend");
+    if(backendVar != NULL && backendVar->getType() == STRING)
+        requested = static_cast<String*>(backendVar)->getValue();
+
+    string out = variantOutputName(outname);
+    LinkJob* job = new LinkJob(path, out, config.objPath, options, libraries, madeLibraries, requested);
+    for(vector<string>::iterator e = objectArgs.begin(); e != objectArgs.end(); e++)
+        job->dependOn(removeQuotes(*e));
+    for(vector<string>::iterator e = madeLibraries.begin(); e != madeLibraries.end(); e++)
+        job->dependOn(*e);
+
+    bool incremental = false;
+    Variable* incrementalVar = c->getVariable("incremental");
+    if(incrementalVar != NULL && incrementalVar->getType() == BOOL)
+        incremental = static_cast<Bool*>(incrementalVar)->getValue();
+    if(incremental)
+    {
+        partialLink(path, objectArgs, job->objects, job->partialJobs);
+        for(vector<PartialLinkJob*>::iterator e = job->partialJobs.begin(); e != job->partialJobs.end(); e++)
+        {
+            if(*e != NULL)
+                job->depends.push_back(*e);
+        }
+    }
+    else
+    {
+        job->objects = objectArgs;
+        job->partialJobs.resize(objectArgs.size(), NULL);
+    }
+
+    vector<string> inputs;
+    for(vector<string>::iterator e = objectArgs.begin(); e != objectArgs.end(); e++)
+        inputs.push_back(removeQuotes(*e));
+    inputs.insert(inputs.end(), madeLibraries.begin(), madeLibraries.end());
+    recordOutput(out, inputs);
+    if(env.emitNinja)
+    {
+        // Without partial links or a backend, which Ninja can't choose
+        vector<string> args;
+        args.push_back(path);
+        args.push_back("-o");
+        args.push_back(quoteWhitespace(out));
+        args.insert(args.end(), objectArgs.begin(), objectArgs.end());
+        args.insert(args.end(), options.begin(), options.end());
+        args.insert(args.end(), libraries.begin(), libraries.end());
+        string buff = joinArgs(args);
+        convertSlashes(buff);
+        recordNinjaLink(out, inputs, buff);
+    }
+
+    addJob(job);
+    setProducer(out, job);
+    addTargetName(outname, job);
+}
+
+// Returns VOID (NULL)
+// Params: ClassObject linker, string outfile, array objects, array libraries, array options
+Variable* fn_link(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4, Variable* arg5)
+{
+    ClassObject* c = convertArg_ClassObject(arg1, "Linker");
+    String* outname = convertArg_String(arg2);
+    Array* objs = convertArg_Array(arg3, STRING);
+    Array* libs = convertArg_Array(arg4, STRING);
+    Array* opts = convertArg_Array(arg5, STRING);
+
+    if(c == NULL || outname == NULL || objs == NULL || libs == NULL || opts == NULL)
+        return NULL;
+
+    linkOutput(c, outname->getValue() + EXE_EXT, objs, libs, opts);
+    return NULL;
+}
+
+// Makes or updates a static library.
+class ArchiveJob : public Job
+{
+    public:
+    vector<string> command;
+    string out;
+    string objPath;
+    vector<string> objects;
+    bool remake;  // True if the archive must be made over
+    string manifestFile;
+
+    ArchiveJob(const vector<string>& command, const string& out, const string& objPath, const vector<string>& objects, bool remake)
+        : command(command)
+        , out(out)
+        , objPath(objPath)
+        , objects(objects)
+        , remake(remake)
+    {
+        manifestFile = outputSideFile(objPath, out, ".members");
+    }
+
+    string start()
+    {
+        /*
+        The manifest remembers how the archive was made and what went into it.
+        If only some objects changed since the archive was written, just those
+        are replaced.  If members were removed or the command changed, it is
+        made over.
+        */
+        vector<string> changed;
+        if(findChangedMembers(out, manifestFile, joinArgs(command), objects, changed) && !remake)
+        {
+            if(changed.size() == 0)
+            {
+                UI_print(" Up to date: %s\n", out.c_str());
+                return "";
+            }
+        }
+        else
+        {
+            ioDelete(out.c_str());
+            changed = objects;
+        }
+        mkpath(ioStripToDir(out));
+
+        vector<string> memberArgs;
+        unsigned int memberLength = 0;
+        for(vector<string>::iterator e = changed.begin(); e != changed.end(); e++)
+        {
+            memberArgs.push_back(quoteWhitespace(*e));
+            memberLength += memberArgs.back().size() + 1;
+        }
+
+        vector<string> args = command;
+        args.push_back(quoteWhitespace(out));
+        if(memberLength > PILE_MAX_COMMAND_LENGTH)
+            args.push_back("@" + quoteWhitespace(writeResponseFile(objPath, out, memberArgs)));
+        else
+            args.insert(args.end(), memberArgs.begin(), memberArgs.end());
+
+        string buff = joinArgs(args);
+        if(changed.size() < objects.size())
+            UI_print("Archiving %d of %d objects: %s\n", changed.size(), objects.size(), buff.c_str());
+        else
+            UI_print("Archiving: %s\n", buff.c_str());
+        convertSlashes(buff);
+        return buff;
+    }
+
+    bool finish(bool success)
+    {
+        if(!success)
+        {
+            UI_error("Archiving failed.\n");
+            ioDelete(manifestFile.c_str());
+            return false;
+        }
+
+        mkpath(objPath);
+        writeIfChanged(manifestFile, makeManifest(joinArgs(command), objects));
+        return true;
+    }
+
+    string getName()
+    {
+        return out;
+    }
+};
+
+// Returns VOID (NULL)
+// Params: ClassObject archiver, string outfile, array objects
+Variable* fn_archive(Variable* arg1, Variable* arg2, Variable* arg3)
+{
+    ClassObject* c = convertArg_ClassObject(arg1, "Archiver");
+    String* outname = convertArg_String(arg2);
+    Array* objs = convertArg_Array(arg3, STRING);
+
+    if(c == NULL || outname == NULL || objs == NULL)
+        return NULL;
+
+    if(objs->size() == 0)
+        return NULL;
+
+    bool thin = false;
+    Variable* thinVar = c->getVariable("thin");
+    if(thinVar != NULL && thinVar->getType() == BOOL)
+        thin = static_cast<Bool*>(thinVar)->getValue();
+
+    // The path holds the program and its key letters, like "ar rsc".
+    list<string> words = ioExplode(static_cast<String*>(c->getVariable("path"))->getValue(), ' ');
+    words.remove("");
+    if(words.size() == 0)
+    {
+        interpreter.error("No archiver path given to archive().\n");
+        return NULL;
+    }
+    string program = quoteWhitespace(words.front());
+    words.pop_front();
+    string keys = (words.size() > 0? words.front() : "rsc");
+    if(words.size() > 0)
+        words.pop_front();
+    if(thin && keys.find('T') == string::npos)
+        keys += "T";
+
+    string out = variantOutputName(outname->getValue());
+    vector<string> objects;
+    list<string> baseNames;
+    bool sameNames = false;
+    for(vector<Variable*>::iterator e = objs->getValue().begin(); e != objs->getValue().end(); e++)
+    {
+        if((*e)->getType() != STRING)
+        {
+            interpreter.error("Wrong type in array sent to archive().\n");
             return NULL;
         }
         String* s = static_cast<String*>(*e);
-        objectstr += quoteWhitespace(s->getValue()) + " ";
+        string object = removeQuotes(s->getValue());
+        objects.push_back(object);
+
+        string base = ioStripToFile(object);
+        if(find(baseNames.begin(), baseNames.end(), base) != baseNames.end())
+            sameNames = true;
+        baseNames.push_back(base);
     }
 
+    vector<string> command;
+    command.push_back(program);
+    command.push_back(keys);
+    command.insert(command.end(), words.begin(), words.end());
+
+    // A regular archive knows its members by base name only, so if two objects
+    // share a name it is always made over.
+    ArchiveJob* job = new ArchiveJob(command, out, config.objPath, objects, sameNames && !thin);
+    for(vector<string>::iterator e = objects.begin(); e != objects.end(); e++)
+        job->dependOn(*e);
+    addJob(job);
+    setProducer(out, job);
+    addTargetName(outname->getValue(), job);
+    recordOutput(out, objects);
+    if(env.emitNinja)
+    {
+        // Made over each time, since Ninja does not know what is in it
+        vector<string> args = command;
+        args.push_back(quoteWhitespace(out));
+        for(vector<string>::iterator e = objects.begin(); e != objects.end(); e++)
+            args.push_back(quoteWhitespace(*e));
+        string buff = joinArgs(args);
+        convertSlashes(buff);
+        recordNinjaLink(out, objects, "rm -f " + quoteWhitespace(out) + " && " + buff);
+    }
+    return NULL;
+}
 
-    char buffer[5000];
-    string out = quoteWhitespace(outname->getValue() + EXE_EXT);
-    string tempname = ".pile.tmp";
-    ioDelete(tempname.c_str());
 
-    sprintf(buffer, "%s -o %s %s %s %s", path.c_str(), out.c_str(), objectstr.c_str(), options.c_str(), libraries.c_str());
-    UI_print("Linking: %s\n", buffer);
-    string buff = buffer;
-    convertSlashes(buff);
+// Gets an object by its name, like cpp_compiler or one that the pilefile
+// declared.
+ClassObject* getNamedObject(const string& name, const string& className)
+{
+    Variable* v = interpreter.getVar(name);
+    if(v == NULL || v->getType() != CLASS_OBJECT)
+    {
+        interpreter.error("There is no %s named %s.\n", className.c_str(), name.c_str());
+        return NULL;
+    }
+    return convertArg_ClassObject(v, className);
+}
 
-    int result = systemCall(buff);
+/*
+Gets the object that a library uses for one of its steps: the one that its
+member names, or else the built-in one for the language of its sources.
+
+Takes: ClassObject* (library)
+       string (member, like "compiler")
+       string (class, like "Compiler")
+       Array* (source file names)
+Returns: ClassObject* (the object, or NULL on error)
+*/
+ClassObject* getLibraryTool(ClassObject* library, const string& member, const string& className, Array* sources)
+{
+    string name = static_cast<String*>(library->getVariable(member))->getValue();
+    if(name == "")
+    {
+        // C sources get the C tools, unless C++ is mixed in.
+        bool c = (sources->size() > 0);
+        for(vector<Variable*>::iterator e = sources->getValue().begin(); c && e != sources->getValue().end(); e++)
+            c = isCExt(getExtension((*e)->getValueString()));
+        name = (c? "c_" : "cpp_") + member;
+    }
+    return getNamedObject(name, className);
+}
 
-    UI_print_file(tempname);
-    ioDelete(tempname.c_str());
-	
-	if(result != 0)
-        UI_error("Linking failed.\n");
+/*
+Compiles the sources of a library into a subdirectory of the object directory.
+
+Takes: ClassObject* (compiler)
+       Array* (source file names)
+       Array* (compiler options)
+       vector<string> (more options for this kind of library)
+       string (subdirectory of the object directory, or "")
+Returns: Array* (object file names, or NULL on error)
+*/
+Array* compileLibraryObjects(ClassObject* compiler, Array* sources, Array* opts, const vector<string>& extra, const string& subdir)
+{
+    Array* options = new Array("<temp>", STRING);
+    for(vector<Variable*>::iterator e = opts->getValue().begin(); e != opts->getValue().end(); e++)
+        options->push_back(new String("<temp>", (*e)->getValueString()));
+    for(vector<string>::const_iterator e = extra.begin(); e != extra.end(); e++)
+    {
+        if(*e != "")
+            options->push_back(new String("<temp>", *e));
+    }
 
-    UI_processEvents();
-    UI_updateScreen();
+    string objPath = config.objPath;
+    if(subdir != "")
+        config.objPath = addDirSlash(objPath) + addDirSlash(subdir);
+    Variable* result = fn_build(compiler, sources, options);
+    config.objPath = objPath;
+
+    if(result == NULL || result->getType() != ARRAY)
+        return NULL;
+    return static_cast<Array*>(result);
+}
+
+// Returns VOID (NULL)
+// Params: ClassObject library, array sources, array options, array link options
+Variable* fn_library(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4)
+{
+    ClassObject* c = convertArg_ClassObject(arg1, "Library");
+    Array* sources = convertArg_Array(arg2, STRING);
+    Array* opts = convertArg_Array(arg3, STRING);
+    Array* linkOpts = convertArg_Array(arg4, STRING);
+
+    if(c == NULL || sources == NULL || opts == NULL || linkOpts == NULL)
+        return NULL;
+
+    string name = static_cast<String*>(c->getVariable("name"))->getValue();
+    string type = static_cast<String*>(c->getVariable("type"))->getValue();
+    bool shareObjects = static_cast<Bool*>(c->getVariable("share_objects"))->getValue();
+    string staticOptions = static_cast<String*>(c->getVariable("static_options"))->getValue();
+    string sharedOptions = static_cast<String*>(c->getVariable("shared_options"))->getValue();
+
+    if(name == "")
+    {
+        interpreter.error("No name given to the library.\n");
+        return NULL;
+    }
+    if(type == "")
+        type = "both";
+    if(type != "both" && type != "static" && type != "shared")
+    {
+        interpreter.error("Library type must be \"both\", \"static\", or \"shared\".\n");
+        return NULL;
+    }
+
+    ClassObject* compiler = getLibraryTool(c, "compiler", "Compiler", sources);
+    ClassObject* archiver = getLibraryTool(c, "archiver", "Archiver", sources);
+    ClassObject* linker = getLibraryTool(c, "linker", "Linker", sources);
+    if(compiler == NULL || archiver == NULL || linker == NULL)
+        return NULL;
+
+    // "shapes" makes libshapes.a and libshapes.so
+    string dir = ioStripToDir(name);
+    string prefix = (dir == ""? "" : addDirSlash(dir)) + "lib" + ioStripToFile(name);
+
+    // Shared objects must be position-independent.  Static libraries can use
+    // the same objects if the pilefile allows it and the options match.
+    Array* sharedObjects = NULL;
+    Array* staticObjects = NULL;
+    if(type != "static")
+    {
+        vector<string> extra;
+        extra.push_back("-fPIC");
+        extra.push_back(sharedOptions);
+        sharedObjects = compileLibraryObjects(compiler, sources, opts, extra, "pic");
+        if(sharedObjects == NULL)
+            return NULL;
+    }
+    if(type != "shared")
+    {
+        if(sharedObjects != NULL && shareObjects && staticOptions == sharedOptions)
+            staticObjects = sharedObjects;
+        else
+        {
+            vector<string> extra;
+            extra.push_back(staticOptions);
+            staticObjects = compileLibraryObjects(compiler, sources, opts, extra, "");
+            if(staticObjects == NULL)
+                return NULL;
+        }
+    }
+
+    if(staticObjects != NULL)
+        fn_archive(archiver, new String("<temp>", prefix + ".a"), staticObjects);
+    if(sharedObjects != NULL)
+    {
+        Array* options = new Array("<temp>", STRING);
+        options->push_back(new String("<temp>", "-shared"));
+        for(vector<Variable*>::iterator e = linkOpts->getValue().begin(); e != linkOpts->getValue().end(); e++)
+            options->push_back(new String("<temp>", (*e)->getValueString()));
+        linkOutput(linker, prefix + SHARED_LIB_EXT, sharedObjects, new Array("<temp>", STRING), options);
+    }
+
+    // The library can be asked for by its name.
+    if(staticObjects != NULL)
+        addTargetName(name, getProducer(variantOutputName(prefix + ".a")));
+    if(sharedObjects != NULL)
+        addTargetName(name, getProducer(variantOutputName(prefix + SHARED_LIB_EXT)));
     return NULL;
 }
 
@@ -449,7 +1833,6 @@ Returns: true on success
 */
 bool build(Environment& env, Configuration& config)
 {
-    char buffer[5000];
     string objName;
     string sourceFile;
     string tempname = ".pile.tmp";
@@ -483,7 +1866,7 @@ bool build(Environment& env, Configuration& config)
         }
         sourceFile = quoteWhitespace(*e);
         FileData* fd = env.fileDataHash[*e];
-        objName = getObjectName(*e, config.objPath, config.useSourceObjPath);
+        objName = objectName(*e);
         mkpath(ioStripToDir(objName));
         objName = quoteWhitespace(objName);
 
@@ -492,10 +1875,15 @@ bool build(Environment& env, Configuration& config)
         // FIXME: mustRebuild() is crashing... Is it fixed yet?
         if(mustRebuild(objName, env.depends, fd))
         {
-            sprintf(buffer, "%s %s -c %s -o %s", getCompiler(config, *e).c_str(), config.cflags.c_str(), sourceFile.c_str(), objName.c_str());
-
-
-            string buff = buffer;
+            vector<string> args;
+            args.push_back(getCompiler(config, *e));
+            args.push_back(config.cflags);
+            args.push_back("-c");
+            args.push_back(sourceFile);
+            args.push_back("-o");
+            args.push_back(objName);
+
+            string buff = joinArgs(args);
             convertSlashes(buff);
 
             UI_print(" Building %s\n  %s\n", e->c_str(), buff.c_str());
@@ -569,19 +1957,21 @@ Returns: true on success
 */
 bool link(const string& linker, Environment& env, Configuration& config)
 {
-    char buffer[5000];
     string out = quoteWhitespace(env.outfile + EXE_EXT);
     string tempname = ".pile.tmp";
     ioDelete(tempname.c_str());
 
-    string objectstr;
+    vector<string> objectArgs;
+    unsigned int objectLength = 0;
     for(list<string>::iterator e = env.sources.begin(); e != env.sources.end(); e++)
     {
-        objectstr += quoteWhitespace(getObjectName(*e, config.objPath, config.useSourceObjPath)) + " ";
+        objectArgs.push_back(quoteWhitespace(objectName(*e)));
+        objectLength += objectArgs.back().size() + 1;
     }
     for(list<string>::iterator e = env.objects.begin(); e != env.objects.end(); e++)
     {
-        objectstr += quoteWhitespace(*e) + " ";
+        objectArgs.push_back(quoteWhitespace(*e));
+        objectLength += objectArgs.back().size() + 1;
     }
 
     map<string, string>::iterator fl = env.variables.find("LFLAGS");
@@ -604,9 +1994,19 @@ bool link(const string& linker, Environment& env, Configuration& config)
         config.lflags += " " + *e;
     }
 
-    sprintf(buffer, "%s -o %s %s %s %s", linker.c_str(), out.c_str(), objectstr.c_str(), config.lflags.c_str(), config.libraries.c_str());
-    UI_print("Linking: %s\n", buffer);
-    string buff = buffer;
+    vector<string> args;
+    args.push_back(linker);
+    args.push_back("-o");
+    args.push_back(out);
+    if(objectLength > PILE_MAX_COMMAND_LENGTH)
+        args.push_back("@" + quoteWhitespace(writeResponseFile(config.objPath, env.outfile, objectArgs)));
+    else
+        args.insert(args.end(), objectArgs.begin(), objectArgs.end());
+    args.push_back(config.lflags);
+    args.push_back(config.libraries);
+
+    string buff = joinArgs(args);
+    UI_print("Linking: %s\n", buff.c_str());
     convertSlashes(buff);
       // Append stdout and stderr to file
     //buff += ">> " + tempname + " 2>&1";
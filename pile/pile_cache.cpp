@@ -0,0 +1,454 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_cache.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the remote build cache and pile-cache-server.  The cache
+speaks a little HTTP/1.1:
+ GET/HEAD/PUT /cas/<hash>  Blobs, named by the hash of their contents
+ GET/HEAD/PUT /ac/<key>    Action results, named by the hash of what the
+                           action depends on (the command and its inputs)
+
+An action result lists the blobs that the action made, in order:
+ PILE-ACTION 1
+ file <hash> <x if executable, - if not>
+*/
+
+#include "pile_global.h"
+#include "pile_cache.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_graph.h"
+#include "pile_net.h"
+#include "pile_stats.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef PILE_LINUX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+string cacheAddress;  // As it was given
+string cacheHost;  // host:port or unix socket
+string cacheBase;  // Path on the server, without the last slash
+bool cacheUpload = false;
+map<string, pair<time_t, string> > fileHashes;  // Time and hash, by file name
+
+
+void setCacheServer(const string& address, bool upload)
+{
+    cacheAddress = address;
+    cacheHost = address;
+    cacheBase = "";
+    cacheUpload = upload;
+    if(cacheHost.substr(0, 7) == "http://")
+    {
+        cacheHost = cacheHost.substr(7);
+        string::size_type slash = cacheHost.find('/');
+        if(slash != string::npos)
+        {
+            cacheBase = cacheHost.substr(slash);
+            cacheHost = cacheHost.substr(0, slash);
+        }
+    }
+    while(cacheBase.size() > 0 && cacheBase[cacheBase.size()-1] == '/')
+        cacheBase.erase(cacheBase.size()-1);
+}
+
+bool usingCache()
+{
+    return (cacheHost != "");
+}
+
+// Two 64-bit FNV-1a hashes, one over the bytes forward and one backward.
+string textHash(const string& text)
+{
+    unsigned long long a = 14695981039346656037ULL;
+    unsigned long long b = 14695981039346656037ULL;
+    unsigned long size = text.size();
+    for(unsigned long i = 0; i < size; i++)
+    {
+        a ^= (unsigned char)text[i];
+        a *= 1099511628211ULL;
+        b ^= (unsigned char)text[size - 1 - i];
+        b *= 1099511628211ULL;
+    }
+    char buff[40];
+    sprintf(buff, "%016llx%016llx", a, b);
+    return buff;
+}
+
+string fileHash(const string& file)
+{
+    time_t t = ioTimeModified(file);
+    map<string, pair<time_t, string> >::iterator e = fileHashes.find(file);
+    if(e != fileHashes.end() && e->second.first == t)
+        return e->second.second;
+
+    if(!ioExists(file))
+        return "";
+    string hash = textHash(readBinaryFile(file));
+    fileHashes[file] = make_pair(t, hash);
+    return hash;
+}
+
+string compilerIdentity(const string& compiler)
+{
+    static map<string, string> identities;
+    map<string, string>::iterator e = identities.find(compiler);
+    if(e != identities.end())
+        return e->second;
+
+    string outfile = PILE_PROJECT_DIR "version.out";
+    mkpath(PILE_PROJECT_DIR);
+    systemCall("(" + compiler + " --version > " + outfile + " 2>&1)");
+    ioDelete(".pile.tmp");
+    string identity = textHash(readBinaryFile(outfile));
+    ioDelete(outfile.c_str());
+
+    UI_debug_pile("Identity of %s: %s\n", compiler.c_str(), identity.c_str());
+    identities[compiler] = identity;
+    return identity;
+}
+
+// Makes sure that a blob or key name can't reach outside its directory.
+bool isHashName(const string& name)
+{
+    if(name.size() < 8 || name.size() > 64)
+        return false;
+    return (name.find_first_not_of("0123456789abcdef") == string::npos);
+}
+
+/*
+Sends one request to the cache server.
+
+Takes: string (method)
+       string (path, like "/cas/<hash>")
+       string (body, for PUT)
+       string (the response body is stored here)
+Returns: int (HTTP status, or 0 if the server could not be reached)
+*/
+int cacheRequest(const string& method, const string& path, const string& body, string& response)
+{
+    Connection conn;
+    if(!connectTo(cacheHost, conn))
+        return 0;
+
+    stringstream request;
+    request << method << " " << cacheBase << path << " HTTP/1.1\r\n"
+            << "Host: " << cacheHost << "\r\n"
+            << "Content-Length: " << body.size() << "\r\n"
+            << "Connection: close\r\n\r\n";
+    if(!conn.send(request.str() + body))
+        return 0;
+
+    string line;
+    if(!conn.readLine(line) || line.substr(0, 5) != "HTTP/")
+        return 0;
+    string::size_type space = line.find(' ');
+    int status = (space == string::npos? 0 : atoi(line.c_str() + space + 1));
+
+    long length = -1;
+    while(conn.readLine(line) && line != "")
+    {
+        string::size_type colon = line.find(':');
+        string name = line.substr(0, colon);
+        for(unsigned int i = 0; i < name.size(); i++)
+            name[i] = tolower(name[i]);
+        if(name == "content-length" && colon != string::npos)
+            length = atol(line.c_str() + colon + 1);
+    }
+
+    response = "";
+    if(method == "HEAD")
+        return status;
+    if(length >= 0)
+    {
+        if(!conn.readBytes(length, response))
+            return 0;
+    }
+    else
+        conn.readAll(response);
+    return status;
+}
+
+bool isExecutable(const string& file)
+{
+    #ifdef PILE_LINUX
+    struct stat info;
+    return (stat(file.c_str(), &info) == 0 && (info.st_mode & S_IXUSR));
+    #else
+    return false;
+    #endif
+}
+
+// Gets an action's files from the cache, for 'pile cache-fetch'.
+bool fetchNow(const string& key, const vector<string>& files)
+{
+    string result;
+    if(cacheRequest("GET", "/ac/" + key, "", result) != 200)
+        return false;
+
+    // Get every blob before anything is replaced.
+    stringstream str(result);
+    string line;
+    if(!getline(str, line) || line != "PILE-ACTION 1")
+        return false;
+    vector<pair<string, bool> > blobs;
+    while(getline(str, line))
+    {
+        stringstream words(line);
+        string word, hash, mode;
+        words >> word >> hash >> mode;
+        if(word == "file" && isHashName(hash))
+            blobs.push_back(make_pair(hash, mode == "x"));
+    }
+    if(blobs.size() != files.size())
+        return false;
+
+    vector<string> data(blobs.size());
+    for(unsigned int i = 0; i < blobs.size(); i++)
+    {
+        if(cacheRequest("GET", "/cas/" + blobs[i].first, "", data[i]) != 200 || textHash(data[i]) != blobs[i].first)
+            return false;
+    }
+
+    for(unsigned int i = 0; i < files.size(); i++)
+    {
+        mkpath(ioStripToDir(files[i]));
+        ioDelete(files[i]);
+        ofstream fout(files[i].c_str(), ios::binary | ios::trunc);
+        fout.write(data[i].data(), data[i].size());
+        fout.close();
+        if(fout.fail())
+            return false;
+        #ifdef PILE_LINUX
+        if(blobs[i].second)
+            chmod(files[i].c_str(), 0755);
+        #endif
+    }
+    return true;
+}
+
+string cacheFetchCommand(const string& key, const vector<string>& files)
+{
+    string command = quoteWhitespace(getExecutablePath()) + " cache-fetch " + quoteWhitespace(cacheAddress) + " " + key;
+    for(vector<string>::const_iterator e = files.begin(); e != files.end(); e++)
+        command += " " + quoteWhitespace(*e);
+    return command;
+}
+
+void countCacheLookup(bool fetched)
+{
+    countStat(fetched? STAT_CACHE_HITS : STAT_CACHE_MISSES);
+}
+
+int runCacheFetch(int argc, char* argv[])
+{
+    if(argc < 3)
+    {
+        UI_error("Usage: pile cache-fetch <address> <key> <files>\n");
+        return 1;
+    }
+    setCacheServer(argv[0], false);
+    return (fetchNow(argv[1], vector<string>(argv + 2, argv + argc))? 0 : 1);
+}
+
+// Does the uploading for uploadToCache().
+void uploadNow(const string& key, const vector<string>& files)
+{
+    string result = "PILE-ACTION 1\n";
+    string response;
+    for(vector<string>::const_iterator e = files.begin(); e != files.end(); e++)
+    {
+        string data = readBinaryFile(*e);
+        string hash = textHash(data);
+        // Blobs are often shared, like between variants.
+        if(cacheRequest("HEAD", "/cas/" + hash, "", response) != 200)
+        {
+            int status = cacheRequest("PUT", "/cas/" + hash, data, response);
+            if(status < 200 || status > 299)
+                return;
+        }
+        result += "file " + hash + (isExecutable(*e)? " x\n" : " -\n");
+    }
+    cacheRequest("PUT", "/ac/" + key, result, response);
+}
+
+void uploadToCache(const string& key, const vector<string>& files)
+{
+    if(!usingCache() || !cacheUpload)
+        return;
+
+    #ifdef PILE_LINUX
+    // Anything printed but not written yet would be written twice.
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        // Whatever is reading pile's output (like a piled client) should not
+        // wait for the upload.
+        int null = open("/dev/null", O_WRONLY);
+        if(null >= 0)
+        {
+            dup2(null, 1);
+            dup2(null, 2);
+        }
+        uploadNow(key, files);
+        _exit(0);
+    }
+    if(pid > 0)
+        return;
+    #endif
+    uploadNow(key, files);
+}
+
+
+// Sends an HTTP response and ends the connection.
+void respond(Connection& conn, int status, const string& reason, const string& body, bool sendBody)
+{
+    stringstream str;
+    str << "HTTP/1.1 " << status << " " << reason << "\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n";
+    conn.send(str.str() + (sendBody? body : ""));
+}
+
+// Answers one request.
+void serveCacheRequest(Connection& conn, const string& dir)
+{
+    string line;
+    if(!conn.readLine(line))
+        return;
+    stringstream words(line);
+    string method, path, version;
+    words >> method >> path >> version;
+
+    long length = 0;
+    while(conn.readLine(line) && line != "")
+    {
+        string::size_type colon = line.find(':');
+        string name = line.substr(0, colon);
+        for(unsigned int i = 0; i < name.size(); i++)
+            name[i] = tolower(name[i]);
+        if(name == "content-length" && colon != string::npos)
+            length = atol(line.c_str() + colon + 1);
+    }
+
+    // Only /cas/<hash> and /ac/<key> are served.
+    string::size_type slash = path.find('/', 1);
+    string kind = (slash == string::npos? "" : path.substr(1, slash - 1));
+    string name = (slash == string::npos? "" : path.substr(slash + 1));
+    if((kind != "cas" && kind != "ac") || !isHashName(name))
+    {
+        respond(conn, 404, "Not Found", "", method != "HEAD");
+        return;
+    }
+    string file = dir + kind + "/" + name;
+
+    if(method == "GET" || method == "HEAD")
+    {
+        if(!ioExists(file))
+        {
+            respond(conn, 404, "Not Found", "", method != "HEAD");
+            return;
+        }
+        respond(conn, 200, "OK", readBinaryFile(file), method != "HEAD");
+        UI_print(" %s %s\n", method.c_str(), path.c_str());
+    }
+    else if(method == "PUT")
+    {
+        string body;
+        if(length < 0 || !conn.readBytes(length, body))
+            return;
+        if(kind == "cas" && textHash(body) != name)
+        {
+            respond(conn, 400, "Bad Request", "The contents do not match the hash.\n", true);
+            return;
+        }
+
+        // Written under another name first, so a reader never sees half of it.
+        stringstream temp;
+        temp << file << ".tmp";
+        #ifdef PILE_LINUX
+        temp << "." << getpid();
+        #endif
+        ofstream fout(temp.str().c_str(), ios::binary | ios::trunc);
+        fout.write(body.data(), body.size());
+        fout.close();
+        if(fout.fail() || rename(temp.str().c_str(), file.c_str()) != 0)
+        {
+            ioDelete(temp.str());
+            respond(conn, 500, "Internal Server Error", "", true);
+            return;
+        }
+        respond(conn, 201, "Created", "", true);
+        UI_print(" PUT %s\n", path.c_str());
+    }
+    else
+        respond(conn, 405, "Method Not Allowed", "", true);
+    fflush(stdout);
+}
+
+int runCacheServer(int argc, char* argv[])
+{
+    string address = PILE_CACHE_DEFAULT_ADDRESS;
+    string dir = getConfigDir() + "cache/";
+    for(int i = 0; i < argc; i++)
+    {
+        if(string("--dir") == argv[i] && i+1 < argc)
+            dir = addDirSlash(argv[++i]);
+        else
+            address = argv[i];
+    }
+    mkpath(dir + "cas/");
+    mkpath(dir + "ac/");
+
+    #ifdef PILE_LINUX
+    int listener = listenOn(address);
+    if(listener < 0)
+    {
+        UI_error("pile error: pile-cache-server could not listen on %s.\n", address.c_str());
+        return 1;
+    }
+    UI_print("pile-cache-server listening on %s, keeping files in %s\n", address.c_str(), dir.c_str());
+    fflush(stdout);
+
+    // Each request is answered by its own process.
+    while(true)
+    {
+        while(waitpid(-1, NULL, WNOHANG) > 0)
+        {}
+
+        Connection conn;
+        if(!acceptConnection(listener, conn))
+            continue;
+
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            close(listener);
+            serveCacheRequest(conn, dir);
+            conn.close();
+            _exit(0);
+        }
+    }
+    #else
+    UI_error("pile error: pile-cache-server is not supported here yet.\n");
+    return 1;
+    #endif
+}
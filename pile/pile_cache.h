@@ -0,0 +1,112 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_cache.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_cache.cpp
+*/
+
+#ifndef _PILE_CACHE_H__
+#define _PILE_CACHE_H__
+
+#include <string>
+#include <vector>
+
+// Where pile-cache-server listens if it is not told
+#define PILE_CACHE_DEFAULT_ADDRESS "127.0.0.1:7080"
+
+/*
+Sets the cache server that builds fetch from and upload to.
+
+Takes: string (address like "host:port" or "http://host:port/path", or "" for
+               no cache)
+       bool (true if results built here should be uploaded)
+*/
+void setCacheServer(const std::string& address, bool upload);
+
+// Tells whether a cache server was set.
+bool usingCache();
+
+/*
+Gets the hash of some text, as used for cache keys and blob names.  It is not
+cryptographic, so the cache has to be trusted.
+
+Takes: string (text)
+Returns: string (32 hex digits)
+*/
+std::string textHash(const std::string& text);
+
+/*
+Gets the hash of a file's contents.  Hashes are remembered until the file's
+time changes.
+
+Takes: string (file name)
+Returns: string (32 hex digits, or "" if the file could not be read)
+*/
+std::string fileHash(const std::string& file);
+
+/*
+Gets what identifies a compiler or linker: the hash of what it prints for
+--version.  Cache keys include it, so that an upgraded compiler at the same
+path doesn't get the old one's objects.  Each one is only asked once per run.
+
+Takes: string (compiler path, quoted if necessary)
+Returns: string (32 hex digits)
+*/
+std::string compilerIdentity(const std::string& compiler);
+
+/*
+Gets the command which fetches the files that an action made from the cache
+and puts them in place.  It is run as a job, so that lookups use the job slots
+like anything else.  The command fails if any file could not be fetched.
+
+Takes: string (action key)
+       vector<string> (the files the action makes, in order)
+Returns: string (the command)
+*/
+std::string cacheFetchCommand(const std::string& key, const std::vector<std::string>& files);
+
+/*
+Counts a finished cache lookup for the stats.
+
+Takes: bool (true if the files were fetched)
+*/
+void countCacheLookup(bool fetched);
+
+/*
+Runs 'pile cache-fetch <address> <key> <files>', the command from
+cacheFetchCommand().
+
+Takes: int (number of arguments after 'cache-fetch')
+       char*[] (those arguments)
+Returns: int (0 if every file was fetched, 1 otherwise)
+*/
+int runCacheFetch(int argc, char* argv[]);
+
+/*
+Uploads the files that an action made to the cache.  This happens in another
+process, so the build does not wait for it.
+
+Takes: string (action key)
+       vector<string> (the files the action made, in order)
+*/
+void uploadToCache(const std::string& key, const std::vector<std::string>& files);
+
+/*
+Runs 'pile cache-server [address] [--dir directory]', which is also what
+'pile-cache-server' does.  It keeps blobs and action results in the directory
+(~/.pile/cache/ by default) and serves them over HTTP forever.
+
+Takes: int (number of arguments after 'cache-server')
+       char*[] (those arguments)
+Returns: int (1 if the server could not start)
+*/
+int runCacheServer(int argc, char* argv[]);
+
+#endif
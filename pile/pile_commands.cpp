@@ -17,6 +17,8 @@ This file contains the functions which implement several command-line options.
 #include "pile_ui.h"
 #include "External Code/goodio.h"
 #include "Eve Source/eve_interpreter.h"
+#include <fstream>
+#include <sstream>
 
 
 extern Interpreter interpreter;
@@ -50,7 +52,7 @@ bool mkpath(const string& path)
     // Find the next /
     // Get the substring old, i - old
     // make it
-    unsigned int i = 0;
+    string::size_type i = 0;
     string dir;
     do
     {
@@ -64,6 +66,64 @@ bool mkpath(const string& path)
     return ioExists(path);
 }
 
+/*
+Reads a whole file.
+
+Takes: string (file name)
+Returns: string (the file's contents, or "" if it could not be read)
+*/
+string readFile(const string& file)
+{
+    ifstream fin(file.c_str());
+    if(fin.fail())
+        return "";
+    stringstream text;
+    text << fin.rdbuf();
+    return text.str();
+}
+
+/*
+Reads a whole file without changing any line endings, like for objects.
+
+Takes: string (file name)
+Returns: string (the file's contents, or "" if it could not be read)
+*/
+string readBinaryFile(const string& file)
+{
+    ifstream fin(file.c_str(), ios::binary);
+    if(fin.fail())
+        return "";
+    stringstream data;
+    data << fin.rdbuf();
+    return data.str();
+}
+
+/*
+Writes a file only if its contents would change, so that its time stamp still
+says when its contents last changed.
+
+Takes: string (file name)
+       string (new contents)
+Returns: true if the file was written
+         false if it was already up to date
+*/
+bool writeIfChanged(const string& file, const string& text)
+{
+    ifstream fin(file.c_str());
+    if(!fin.fail())
+    {
+        stringstream old;
+        old << fin.rdbuf();
+        if(old.str() == text)
+            return false;
+    }
+    fin.close();
+
+    ofstream fout(file.c_str(), ios::trunc);
+    fout << text;
+    return true;
+}
+
 /*
 Deletes temporary files.
 
@@ -17,6 +17,9 @@ Header for pile_commands.cpp
 
 
 bool mkpath(const string& path);
+string readFile(const string& file);
+string readBinaryFile(const string& file);
+bool writeIfChanged(const string& file, const string& text);
 bool clean(bool cleanall, const list<string>& sources, Configuration& config, const string& outfile);
 bool cleanOld(bool cleanall, const list<string>& sources, Configuration& config, const string& outfile);
 bool edit(string file, Configuration& config);
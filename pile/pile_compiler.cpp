@@ -0,0 +1,61 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_compiler.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains what Pile knows about the compilers it runs: which family
+a compiler belongs to, and whether it takes an option that not every version
+has.
+*/
+
+#include "pile_global.h"
+#include "pile_compiler.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_graph.h"
+#include "pile_system.h"
+#include "pile_ui.h"
+#include "External Code/goodio.h"
+#include <fstream>
+#include <map>
+
+
+CompilerFamily getCompilerFamily(const string& compiler)
+{
+    string name = ioStripToFile(compiler);
+    if(name.find("clang") != string::npos)
+        return COMPILER_CLANG;
+    if(name.find("gcc") != string::npos || name.find("g++") != string::npos || name == "cc" || name == "c++")
+        return COMPILER_GCC;
+    return COMPILER_UNKNOWN;
+}
+
+bool compilerAccepts(const string& compiler, const string& option)
+{
+    static map<pair<string, string>, bool> answers;
+    map<pair<string, string>, bool>::iterator e = answers.find(make_pair(compiler, option));
+    if(e != answers.end())
+        return e->second;
+
+    mkpath(PILE_PROJECT_DIR);
+    string source = PILE_PROJECT_DIR "probe.c";
+    string object = PILE_PROJECT_DIR "probe.o";
+    ofstream fout(source.c_str(), ios::trunc);
+    fout << "int pile_probe;" << endl;
+    fout.close();
+
+    bool accepted = (systemCall(compiler + " " + option + " -c " + source + " -o " + object) == 0 && ioExists(object));
+    ioDelete(".pile.tmp");
+    ioDelete(source.c_str());
+    ioDelete(object.c_str());
+
+    UI_debug_pile("%s %s %s\n", compiler.c_str(), (accepted? "takes" : "does not take"), option.c_str());
+    answers[make_pair(compiler, option)] = accepted;
+    return accepted;
+}
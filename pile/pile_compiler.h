@@ -0,0 +1,47 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_compiler.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_compiler.cpp
+*/
+
+#ifndef _PILE_COMPILER_H__
+#define _PILE_COMPILER_H__
+
+#include <string>
+
+// The kinds of compiler driver whose options Pile knows
+enum CompilerFamily
+{
+    COMPILER_UNKNOWN,
+    COMPILER_GCC,  // gcc, g++, cc, and c++
+    COMPILER_CLANG  // clang and clang++
+};
+
+/*
+Tells what kind of compiler driver a compiler is, from its name.
+
+Takes: string (compiler path)
+Returns: CompilerFamily (COMPILER_UNKNOWN if Pile doesn't know it)
+*/
+CompilerFamily getCompilerFamily(const std::string& compiler);
+
+/*
+Tells whether a compiler takes an option, by compiling a tiny source with it.
+Each compiler and option is only tried once per run.
+
+Takes: string (compiler path, quoted if necessary)
+       string (the option, quoted if necessary)
+Returns: true if the compile worked
+         false otherwise
+*/
+bool compilerAccepts(const std::string& compiler, const std::string& option);
+
+#endif
@@ -89,8 +89,10 @@ bool createConfig(string path, Configuration& config)
                   << config.languages.find("C_SYNTAX")->second << endl;*/
     fout << "cpp_compiler.name = " << quoteThis(config.languages.find("CPP_COMPILER")->second) << endl;
     fout << "cpp_compiler.path = " << quoteThis(config.languages.find("CPP_COMPILER")->second) << endl;
+    fout << "cpp_compiler.batch_size = " << config.batchSize << endl;
     fout << "cpp_linker.name = " << quoteThis(config.languages.find("CPP_LINKER_D")->second) << endl;
     fout << "cpp_linker.path = " << quoteThis(config.languages.find("CPP_LINKER_D")->second) << endl;
+    fout << "cpp_linker.backend = " << quoteThis(config.linkerBackend) << endl;
     /*fout << "lang FORTRAN: " << config.languages.find("FORTRAN_COMPILER")->second << ", "
                   << config.languages.find("FORTRAN_LINKER_D")->second << ", "
                   << config.languages.find("FORTRAN_LINKER_S")->second << ", "
@@ -99,6 +101,12 @@ bool createConfig(string path, Configuration& config)
     fout << "PROGRAM_INSTALL_DIR = " << quoteThis(config.programInstallPath) << endl;
     fout << "LIBRARY_INSTALL_DIR = " << quoteThis(config.libInstallPath) << endl;
     fout << "HEADER_INSTALL_DIR = " << quoteThis(config.headerInstallPath) << endl;
+    fout << "CHANGE_DETECTION = " << quoteThis(config.changeDetection) << endl;
+    string workers;
+    for(list<string>::const_iterator e = config.workers.begin(); e != config.workers.end(); e++)
+        workers += (workers == ""? "" : ",") + *e;
+    fout << "WORKERS = " << quoteThis(workers) << endl;
+    fout << "CACHE = " << quoteThis(config.cache) << endl;
 
     /*fout << "includeDirs:";
     for(list<string>::iterator e = config.includePaths.begin(); e != config.includePaths.end(); e++)
@@ -187,6 +195,12 @@ bool loadConfig(string path, Configuration& config)
     lib_install_path->reference = true;
     String* header_install_path = new String("HEADER_INSTALL_DIR", config.headerInstallPath);
     header_install_path->reference = true;
+    String* change_detection = new String("CHANGE_DETECTION", config.changeDetection);
+    change_detection->reference = true;
+    String* workers = new String("WORKERS", "");
+    workers->reference = true;
+    String* cache = new String("CACHE", config.cache);
+    cache->reference = true;
 
     s.env["CONFIG_FORMAT_VERSION_MAJOR"] = version_major;
     s.env["CONFIG_FORMAT_VERSION_MINOR"] = version_minor;
@@ -200,40 +214,51 @@ bool loadConfig(string path, Configuration& config)
     s.env["PROGRAM_INSTALL_DIR"] = program_install_path;
     s.env["LIBRARY_INSTALL_DIR"] = lib_install_path;
     s.env["HEADER_INSTALL_DIR"] = header_install_path;
+    s.env["CHANGE_DETECTION"] = change_detection;
+    s.env["WORKERS"] = workers;
+    s.env["CACHE"] = cache;
 
 
     // Add Compiler
     Class* compiler = new Class("Compiler");
     compiler->addVariable("string", "name");
     compiler->addVariable("string", "path");
+    compiler->addVariable("int", "batch_size");
     interpreter.addClass(compiler);
 
     ClassObject* cpp_compiler = new ClassObject("cpp_compiler", "Compiler");
     cpp_compiler->reference = true;
     Variable* cpp_name = cpp_compiler->getVariable("name");
     Variable* cpp_path = cpp_compiler->getVariable("path");
+    Variable* cpp_batch = cpp_compiler->getVariable("batch_size");
     if(cpp_name != NULL && cpp_path != NULL && cpp_name->getType() == STRING && cpp_path->getType() == STRING)
     {
         static_cast<String*>(cpp_name)->setValue(config.languages["CPP_COMPILER"]);
         static_cast<String*>(cpp_path)->setValue(config.languages["CPP_COMPILER"]);
     }
+    if(cpp_batch != NULL && cpp_batch->getType() == INT)
+        static_cast<Int*>(cpp_batch)->setValue(config.batchSize);
     s.env["cpp_compiler"] = cpp_compiler;
 
     // Add Linker
     Class* linker = new Class("Linker");
     linker->addVariable("string", "name");
     linker->addVariable("string", "path");
+    linker->addVariable("string", "backend");
     interpreter.addClass(linker);
 
     ClassObject* cpp_linker = new ClassObject("cpp_linker", "Linker");
     cpp_linker->reference = true;
     Variable* cpp_linkname = cpp_linker->getVariable("name");
     Variable* cpp_linkpath = cpp_linker->getVariable("path");
+    Variable* cpp_backend = cpp_linker->getVariable("backend");
     if(cpp_linkname != NULL && cpp_linkpath != NULL && cpp_linkname->getType() == STRING && cpp_linkpath->getType() == STRING)
     {
         static_cast<String*>(cpp_linkname)->setValue(config.languages["CPP_LINKER_D"]);
         static_cast<String*>(cpp_linkpath)->setValue(config.languages["CPP_LINKER_D"]);
     }
+    if(cpp_backend != NULL && cpp_backend->getType() == STRING)
+        static_cast<String*>(cpp_backend)->setValue(config.linkerBackend);
     s.env["cpp_linker"] = cpp_linker;
 
 
@@ -258,11 +283,19 @@ bool loadConfig(string path, Configuration& config)
         // FIXME: This needs to be much better and flexible
         config.languages["CPP_COMPILER"] = static_cast<String*>(cpp_path)->getValue();
         config.languages["CPP_LINKER_D"] = static_cast<String*>(cpp_linkpath)->getValue();
+        if(cpp_batch != NULL && cpp_batch->getType() == INT)
+            config.batchSize = static_cast<Int*>(cpp_batch)->getValue();
+        if(cpp_backend != NULL && cpp_backend->getType() == STRING)
+            config.linkerBackend = static_cast<String*>(cpp_backend)->getValue();
 
         config.binInstallPath = bin_install_path->getValue();
         config.programInstallPath = program_install_path->getValue();
         config.libInstallPath = lib_install_path->getValue();
         config.headerInstallPath = header_install_path->getValue();
+        config.changeDetection = change_detection->getValue();
+        config.workers = ioExplode(workers->getValue(), ',');
+        config.workers.remove("");
+        config.cache = cache->getValue();
 
         interpreter.reset();
     }
@@ -33,6 +33,7 @@ class Configuration
     
     bool useSourceObjPath; // Makes the object path relative to each source file for the respective object file
     std::string objPath;
+    std::string variant;  // The variant being built, if one was asked for.  Its objects and outputs go into their own directories.
     std::list<std::string> includePaths;
     std::list<std::string> libPaths;
     
@@ -49,12 +50,25 @@ class Configuration
     
     bool useAutoDepend;
     
+    int batchSize;  // Number of sources to give to each compiler call (0 or 1 disables batching)
+    std::string linkerBackend;  // "auto", "default", "mold", "lld", or "gold"
+    int jobs;  // Number of commands to run at once (0 uses one per processor)
+    std::string changeDetection;  // "stat" checks the time of every file, "git" asks git what changed
+    std::list<std::string> workers;  // pile-worker addresses that compiles can be sent to, one per slot
+    std::string cache;  // pile-cache-server address that objects and outputs are fetched from, or ""
+    bool cacheUpload;  // Whether what is built here goes into the cache
+    
     Configuration()
         : exe_ext(EXE_EXT)
         , editor(DEFAULT_EDITOR)
         , useSourceObjPath(false)
         , objPath("obj/")
         , useAutoDepend(true)
+        , batchSize(0)
+        , linkerBackend("auto")
+        , jobs(0)
+        , changeDetection("stat")
+        , cacheUpload(true)
     {
         languages["EDITOR"] = DEFAULT_C_COMPILER;
         languages["C_COMPILER"] = DEFAULT_C_COMPILER;
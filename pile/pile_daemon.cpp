@@ -0,0 +1,296 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_daemon.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains piled, which keeps a project's state loaded between builds,
+and the client side that 'pile' uses to send it commands.
+
+A request is a few lines:
+ PILED 1
+ cwd <directory of the client>
+ arg <argument>  (once for each argument)
+ end
+or "stop" instead of the rest.  The reply to a request that piled takes starts
+with the same "PILED 1" line, then has what the build prints, and ends with
+"exit <code>".  piled closes the connection without replying to a request
+that it won't take, and pile then runs the command itself.
+*/
+
+#include "pile_global.h"
+#include "pile_daemon.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_depend.h"
+#include "pile_env.h"
+#include "pile_graph.h"
+#include "pile_net.h"
+#include "pile_stats.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#ifdef PILE_LINUX
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+extern Environment env;
+extern Configuration config;
+
+time_t configTime = 0;  // When the loaded pile.conf was saved
+
+
+bool canUseDaemon(int argc, char* argv[])
+{
+    if(!ioExists(PILE_DAEMON_SOCKET) || ioStripToFile(argv[0]) == "piled")
+        return false;
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "--no-daemon" || arg == "-g" || arg == "new" || arg == "edit" || arg == "daemon"
+           || arg == "watch" || arg == "--version" || ioStripToExt(arg) == "pile")
+            return false;
+    }
+    return true;
+}
+
+/*
+Sends a request and prints the reply.
+
+Takes: string (request)
+       int (the exit code from the reply is stored here)
+Returns: true if piled took the request
+         false otherwise
+*/
+bool sendToDaemon(const string& request, int& exitCode)
+{
+    Connection conn;
+    if(!connectTo(PILE_DAEMON_SOCKET, conn))
+    {
+        UI_print("pile: No piled is answering at %s, so it is removed.\n", PILE_DAEMON_SOCKET);
+        ioDelete(PILE_DAEMON_SOCKET);
+        return false;
+    }
+    string line;
+    if(!conn.send(request) || !conn.readLine(line) || line != PILE_DAEMON_PROTOCOL)
+        return false;
+
+    // The exit code comes last, so each line is printed once the next one
+    // has come.  A reply that stops early means the build did not finish.
+    exitCode = 1;
+    string last;
+    bool haveLast = false;
+    while(conn.readLine(line))
+    {
+        if(haveLast)
+        {
+            printf("%s\n", last.c_str());
+            fflush(stdout);
+        }
+        last = line;
+        haveLast = true;
+    }
+    if(conn.buffer != "")
+    {
+        if(haveLast)
+            printf("%s\n", last.c_str());
+        printf("%s", conn.buffer.c_str());
+        haveLast = false;
+    }
+    if(haveLast)
+    {
+        if(last.compare(0, 5, "exit ") == 0)
+            exitCode = atoi(last.c_str() + 5);
+        else
+            printf("%s\n", last.c_str());
+    }
+    fflush(stdout);
+    return true;
+}
+
+bool runOnDaemon(int argc, char* argv[], int& exitCode)
+{
+    string request = PILE_DAEMON_PROTOCOL "\n";
+    request += "cwd " + ioGetCWD() + "\n";
+    for(int i = 1; i < argc; i++)
+        request += string("arg ") + argv[i] + "\n";
+    request += "end\n";
+    return sendToDaemon(request, exitCode);
+}
+
+
+int forkBuild(const vector<string>& args, int (*runBuild)(int, char*[]), int outputFd)
+{
+    #ifdef PILE_LINUX
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        // Its commands go with it if it is stopped.
+        setpgid(0, 0);
+        int null = open("/dev/null", O_RDONLY);
+        if(null >= 0)
+            dup2(null, 0);
+        if(outputFd >= 0)
+        {
+            dup2(outputFd, 1);
+            dup2(outputFd, 2);
+            close(outputFd);
+        }
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        startStats();
+
+        vector<char*> argv;
+        argv.push_back((char*)"pile");
+        for(unsigned int i = 0; i < args.size(); i++)
+            argv.push_back((char*)args[i].c_str());
+        argv.push_back(NULL);
+        int exitCode = runBuild(argv.size() - 1, &argv[0]);
+
+        // The output is done before the graph is saved.  piled sends the
+        // exit code once this process has ended.
+        fflush(stdout);
+        fflush(stderr);
+        close(1);
+        close(2);
+        saveDepends(PILE_DAEMON_STATE_FILE, env.depends, env.fileDataHash);
+        _exit(exitCode);
+    }
+    return pid;
+    #else
+    return -1;
+    #endif
+}
+
+void keepBuildState()
+{
+    if(loadDepends(PILE_DAEMON_STATE_FILE, env.depends, env.fileDataHash))
+        ioDelete(PILE_DAEMON_STATE_FILE);
+}
+
+void reloadConfig()
+{
+    string configDir = getConfigDir();
+    time_t t = ioTimeModified(configDir + "pile.conf");
+    // The first time, it was just loaded.
+    if(configTime != 0 && t != configTime)
+    {
+        UI_print("pile.conf changed, so it is loaded again.\n");
+        config = Configuration();
+        loadConfig(configDir, config);
+        env.loadConfig(config);
+    }
+    configTime = t;
+}
+
+int runDaemon(int argc, char* argv[], int (*runBuild)(int, char*[]))
+{
+    if(argc > 0 && string("stop") == argv[0])
+    {
+        int exitCode = 0;
+        if(!sendToDaemon(PILE_DAEMON_PROTOCOL "\nstop\n", exitCode))
+        {
+            UI_error("pile error: There is no piled running here.\n");
+            return 1;
+        }
+        return exitCode;
+    }
+
+    #ifdef PILE_LINUX
+    string root = ioGetCWD();
+    Connection test;
+    if(connectTo(PILE_DAEMON_SOCKET, test))
+    {
+        UI_error("pile error: piled is already running here.\n");
+        return 1;
+    }
+    // Nothing answered, so a socket that is there was left by a piled that
+    // was killed.
+    ioDelete(PILE_DAEMON_SOCKET);
+    mkpath(PILE_PROJECT_DIR);
+    int listener = listenOn(PILE_DAEMON_SOCKET);
+    if(listener < 0)
+    {
+        UI_error("pile error: piled could not listen on %s.\n", PILE_DAEMON_SOCKET);
+        return 1;
+    }
+    // Builds and their commands should not keep it open.
+    fcntl(listener, F_SETFD, FD_CLOEXEC);
+    UI_print("piled serving %s\n", root.c_str());
+    fflush(stdout);
+    reloadConfig();
+
+    // One build at a time, since they would share the same files.
+    while(true)
+    {
+        Connection conn;
+        if(!acceptConnection(listener, conn))
+            continue;
+
+        string line;
+        if(!conn.readLine(line) || line != PILE_DAEMON_PROTOCOL || !conn.readLine(line))
+            continue;
+        if(line == "stop")
+        {
+            conn.send(PILE_DAEMON_PROTOCOL "\npiled stopped.\nexit 0\n");
+            break;
+        }
+
+        vector<string> args;
+        string cwd;
+        while(line != "end")
+        {
+            if(line.substr(0, 4) == "cwd ")
+                cwd = line.substr(4);
+            else if(line.substr(0, 4) == "arg ")
+                args.push_back(line.substr(4));
+            if(!conn.readLine(line))
+                break;
+        }
+        if(line != "end")
+            continue;
+        // Closing without a reply makes pile build there by itself.
+        if(absolutePath(cwd) != absolutePath(root))
+        {
+            UI_print("Not building for %s, since this piled serves %s.\n", cwd.c_str(), root.c_str());
+            fflush(stdout);
+            continue;
+        }
+
+        // Anything edited since the last build is read again.
+        reloadConfig();
+        refreshDepends(env.depends, env.fileDataHash);
+        if(!conn.send(PILE_DAEMON_PROTOCOL "\n"))
+            continue;
+        pid_t pid = forkBuild(args, runBuild, conn.fd);
+        int status = 0;
+        bool ended = (pid > 0 && waitpid(pid, &status, 0) == pid);
+        stringstream str;
+        str << "exit " << (ended && WIFEXITED(status)? WEXITSTATUS(status) : 1) << "\n";
+        conn.send(str.str());
+        conn.close();
+        if(ended)
+            keepBuildState();
+    }
+
+    close(listener);
+    ioDelete(PILE_DAEMON_SOCKET);
+    return 0;
+    #else
+    UI_error("pile error: piled is not supported here yet.\n");
+    return 1;
+    #endif
+}
@@ -0,0 +1,90 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_daemon.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_daemon.cpp
+*/
+
+#ifndef _PILE_DAEMON_H__
+#define _PILE_DAEMON_H__
+
+#include <string>
+#include <vector>
+
+// Where piled listens, in the project's directory
+#define PILE_DAEMON_SOCKET ".pile/piled.sock"
+
+// Where each build served by piled leaves the include graph for the next one
+#define PILE_DAEMON_STATE_FILE ".pile/piled.state"
+
+// The first line of every request to piled
+#define PILE_DAEMON_PROTOCOL "PILED 1"
+
+/*
+Tells whether a command can be sent to a piled in this directory.  Commands
+which make or edit files (like 'pile new'), use the GUI, change directory, or
+have '--no-daemon' are run here.
+
+Takes: int (number of arguments, as given to main())
+       char*[] (arguments)
+Returns: true if it can be sent
+         false otherwise
+*/
+bool canUseDaemon(int argc, char* argv[]);
+
+/*
+Sends a command to the piled in this directory and prints what it prints.  A
+socket that no piled answers on is left from one that was killed, so it is
+removed.
+
+Takes: int (number of arguments, as given to main())
+       char*[] (arguments)
+       int (the command's exit code is stored here)
+Returns: true if piled ran the command
+         false if there is no piled here or it did not take the command (like
+         when it serves another directory), so the command should be run here
+*/
+bool runOnDaemon(int argc, char* argv[], int& exitCode);
+
+/*
+Runs a build in a copy of this process, which starts with everything loaded
+here.  It is in its own process group, so killing the group stops its commands
+too.  When it is done, keepBuildState() takes the include graph that it found.
+It exits with what runBuild returns.
+
+Takes: vector<string> (build arguments, without the program name)
+       int (*)(int, char*[]) (runs a build, with arguments like main()'s)
+       int (where its output goes, or -1 for the same place as this
+            process's)
+Returns: int (process ID, or -1 if it could not be started)
+*/
+int forkBuild(const std::vector<std::string>& args, int (*runBuild)(int, char*[]), int outputFd);
+
+// Loads the include graph left by the last build from forkBuild().
+void keepBuildState();
+
+// Loads pile.conf again if it was changed since it was last loaded here.
+void reloadConfig();
+
+/*
+Runs 'pile daemon', which is also what 'piled' does, or 'pile daemon stop'.
+piled keeps pile.conf and the include graph loaded and runs each build it is
+sent in a copy of itself, so a build only pays for reading the pilefile and
+checking times.  pile.conf is loaded again when it changes.  It must be started in the pilefile's directory, after
+pile.conf is loaded.
+
+Takes: int (number of arguments after 'daemon')
+       char*[] (those arguments)
+       int (*)(int, char*[]) (runs a build, with arguments like main()'s)
+Returns: int (1 if the daemon could not start)
+*/
+int runDaemon(int argc, char* argv[], int (*runBuild)(int, char*[]));
+
+#endif
@@ -15,13 +15,21 @@ dependencies.
 
 #include "pile_global.h"
 #include "pile_depend.h"
+#include "pile_stats.h"
 #include "pile_ui.h"
 #include <fstream>
+#include <set>
 
 string getFilePath(string file);
 bool isWhitespace(const char& c);
 void removePath(string& file);
 
+// Files whose includes have been read and are in the graph
+set<string> scannedFiles;
+// Where each scanned file's missing includes were looked for, so that the file
+// is read again when one of them shows up
+map<string, set<string> > missingIncludes;
+
 /*
 The strategy:
 *Get list of source files.
@@ -120,7 +128,7 @@ void removeUpTo(string& str, char c)
 void removeBackTo(string& str, char c)
 {
     //UI_debug_pile("Removing back to: \"%s\", %c", str.c_str(), c);
-    unsigned int pos = str.find_last_of(c);
+    string::size_type pos = str.find_last_of(c);
     if(pos != string::npos)
         str = str.substr(0, pos + 1);
     else
@@ -130,8 +138,8 @@ void removeBackTo(string& str, char c)
 
 char removeQuantifiers(string& str)
 {
-    unsigned int quote = str.find_first_of('\"');
-    unsigned int angle = str.find_first_of('<');
+    string::size_type quote = str.find_first_of('\"');
+    string::size_type angle = str.find_first_of('<');
     char result = '\"';
     
     if(quote == string::npos)
@@ -184,7 +192,7 @@ list<string> explode(string str, char c)
     list<string> result;
     
     unsigned int oldPos = 0;
-    unsigned int pos = str.find_first_of(c);
+    string::size_type pos = str.find_first_of(c);
     while(pos != string::npos)
     {
         result.push_back(str.substr(oldPos, pos - oldPos));
@@ -200,10 +208,18 @@ list<string> explode(string str, char c)
 }
 
 
+// Checks if an include exists, trusting git about files that have not changed.
+bool includeExists(const string& file)
+{
+    time_t t;
+    return (getUnchangedTime(file, t) || ioExists(file));
+}
+
 list<string> readIncludes(const list<string>& paths, const string& file)
 {
     //UI_debug_pile("Reading %s\n", file.c_str());
     list<string> result;
+    missingIncludes.erase(file);
     
     ifstream fin;
     fin.open(file.c_str());
@@ -235,6 +251,7 @@ list<string> readIncludes(const list<string>& paths, const string& file)
         if(!gotIt)
             return result;
     }
+    countStat(STAT_FILES_SCANNED);
     
     string path = getFilePath(file);
     
@@ -275,18 +292,20 @@ list<string> readIncludes(const list<string>& paths, const string& file)
                     
                     removeQuantifiers(str);
                     
-                    if(ioExists(path + str))
+                    if(includeExists(path + str))
                         str = path + str;
                     else
                     {
                         //UI_debug_pile("Dependency %s not found locally...  Checking default paths.\n", str.c_str());
+                        bool found = false;
                         for(list<string>::const_iterator e = paths.begin(); e != paths.end(); e++)
                         {
                             //UI_debug_pile("Checking if %s exists... ", (*e + '/' + str).c_str());
-                            if(ioExists(*e + '/' + str))
+                            if(includeExists(*e + '/' + str))
                             {
                                 //UI_debug_pile("Yep\n");
                                 str = *e + '/' + str;
+                                found = true;
                                 break;
                             }
                             else
@@ -294,6 +313,13 @@ list<string> readIncludes(const list<string>& paths, const string& file)
                                 //UI_debug_pile("Nope\n");
                             }
                         }
+                        if(!found)
+                        {
+                            set<string>& tried = missingIncludes[file];
+                            tried.insert(path + str);
+                            for(list<string>::const_iterator e = paths.begin(); e != paths.end(); e++)
+                                tried.insert(*e + '/' + str);
+                        }
                     }
                     
                     //UI_debug_pile("Pushing: %s\n", str.c_str());
@@ -343,6 +369,7 @@ bool addDepend(map<FileData*, list<FileData*> >& depends, map<string, FileData*>
     {
         // Add to the dependencies.
         depends[fdp].push_back(fdi);
+        countStat(STAT_DEPEND_EDGES);
         return true;
     }
     return false;
@@ -352,7 +379,15 @@ bool addDepend(map<FileData*, list<FileData*> >& depends, map<string, FileData*>
 
 void recurseIncludes(map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash, const list<string>& paths, const string& file, string path)
 {
+    // Its includes are already in the graph.
+    if(!scannedFiles.insert(file).second)
+        return;
+    // A source that includes nothing still needs its time, or it would be
+    // rebuilt every time.
+    if(fileDataHash[file] == NULL)
+        fileDataHash[file] = new FileData(file);
     list<string> includes = readIncludes(paths, file);
+    countStat(STAT_INCLUDES_RESOLVED, includes.size());
     for(list<string>::iterator e = includes.begin(); e != includes.end(); e++)
     {
         //UI_debug_pile("%s includes: %s\n", file.c_str(), e->c_str());
@@ -382,6 +417,183 @@ void recurseIncludes(map<FileData*, list<FileData*> >& depends, map<string, File
 
 
 
+// Adds all of the files that 'file' depends on, directly or not, to 'result'.
+void collectDepends(map<FileData*, list<FileData*> >& depends, FileData* file, set<FileData*>& result)
+{
+    map<FileData*, list<FileData*> >::iterator d = depends.find(file);
+    if(d == depends.end())
+        return;
+    for(list<FileData*>::iterator e = d->second.begin(); e != d->second.end(); e++)
+    {
+        if(result.insert(*e).second)
+            collectDepends(depends, *e, result);
+    }
+}
+
+void refreshDepends(map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    // Check the time of every file.
+    set<FileData*> changed;
+    for(map<string, FileData*>::iterator e = fileDataHash.begin(); e != fileDataHash.end(); e++)
+    {
+        FileData* fd = e->second;
+        if(fd == NULL)
+            continue;
+        bool existed = fd->exists();
+        time_t t = fd->getTime();
+        fd->checkExistence();
+        if(fd->exists())
+            fd->checkTime();
+        else
+            fd->setDependTime(0);
+        if(fd->exists() != existed || (fd->exists() && fd->getTime() != t))
+            changed.insert(fd);
+    }
+
+    // A missing include is kept under the name it was included by, so a file
+    // is read again when any place that include was looked for has it now.
+    map<string, bool> seen;
+    for(map<string, set<string> >::iterator e = missingIncludes.begin(); e != missingIncludes.end(); e++)
+    {
+        FileData* fd = fileDataHash[e->first];
+        if(fd == NULL)
+            continue;
+        for(set<string>::iterator f = e->second.begin(); f != e->second.end(); f++)
+        {
+            map<string, bool>::iterator s = seen.find(*f);
+            if(s == seen.end())
+                s = seen.insert(make_pair(*f, ioExists(*f))).first;
+            if(s->second)
+            {
+                UI_debug_pile("Found %s, which %s was missing\n", f->c_str(), e->first.c_str());
+                changed.insert(fd);
+                break;
+            }
+        }
+    }
+
+    // A changed file is read again, and so is everything that includes it,
+    // so that the next scan reaches it.
+    map<FileData*, list<FileData*> > includedBy;
+    for(map<FileData*, list<FileData*> >::iterator e = depends.begin(); e != depends.end(); e++)
+    {
+        for(list<FileData*>::iterator f = e->second.begin(); f != e->second.end(); f++)
+            includedBy[*f].push_back(e->first);
+    }
+    list<FileData*> waiting(changed.begin(), changed.end());
+    while(waiting.size() > 0)
+    {
+        FileData* fd = waiting.front();
+        waiting.pop_front();
+        depends.erase(fd);
+        for(map<string, FileData*>::iterator e = fileDataHash.begin(); e != fileDataHash.end(); e++)
+        {
+            if(e->second == fd)
+                scannedFiles.erase(e->first);
+        }
+        list<FileData*>& parents = includedBy[fd];
+        for(list<FileData*>::iterator e = parents.begin(); e != parents.end(); e++)
+        {
+            if(changed.insert(*e).second)
+                waiting.push_back(*e);
+        }
+    }
+
+    // What is left of the graph still holds, so the times can be carried up.
+    for(map<FileData*, list<FileData*> >::iterator e = depends.begin(); e != depends.end(); e++)
+    {
+        set<FileData*> all;
+        collectDepends(depends, e->first, all);
+        for(set<FileData*>::iterator f = all.begin(); f != all.end(); f++)
+        {
+            if(e->first->getDependTime() < (*f)->getTime())
+                e->first->setDependTime((*f)->getTime());
+        }
+    }
+}
+
+set<string> getMissingIncludes()
+{
+    set<string> result;
+    for(map<string, set<string> >::iterator e = missingIncludes.begin(); e != missingIncludes.end(); e++)
+        result.insert(e->second.begin(), e->second.end());
+    return result;
+}
+
+/*
+The graph is saved with one entry per line, separated by tabs:
+ scanned <file>
+ depend <file> <included file>
+ missing <file> <where a missing include was looked for>
+*/
+bool saveDepends(const string& file, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    ofstream fout(file.c_str(), ios::trunc);
+    if(fout.fail())
+        return false;
+    for(set<string>::iterator e = scannedFiles.begin(); e != scannedFiles.end(); e++)
+        fout << "scanned\t" << *e << endl;
+    for(map<string, set<string> >::iterator e = missingIncludes.begin(); e != missingIncludes.end(); e++)
+    {
+        for(set<string>::iterator f = e->second.begin(); f != e->second.end(); f++)
+            fout << "missing\t" << e->first << "\t" << *f << endl;
+    }
+    for(map<string, FileData*>::iterator e = fileDataHash.begin(); e != fileDataHash.end(); e++)
+    {
+        map<FileData*, list<FileData*> >::iterator d = depends.find(e->second);
+        if(e->second == NULL || d == depends.end())
+            continue;
+        for(list<FileData*>::iterator f = d->second.begin(); f != d->second.end(); f++)
+            fout << "depend\t" << e->first << "\t" << (*f)->getPath() << endl;
+    }
+    return true;
+}
+
+bool loadDepends(const string& file, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    ifstream fin(file.c_str());
+    if(fin.fail())
+        return false;
+
+    set<FileData*> old;
+    for(map<string, FileData*>::iterator e = fileDataHash.begin(); e != fileDataHash.end(); e++)
+        old.insert(e->second);
+    for(set<FileData*>::iterator e = old.begin(); e != old.end(); e++)
+        delete *e;
+    depends.clear();
+    fileDataHash.clear();
+    scannedFiles.clear();
+    missingIncludes.clear();
+
+    string line;
+    while(getline(fin, line))
+    {
+        string::size_type tab = line.find('\t');
+        if(tab == string::npos)
+            continue;
+        string kind = line.substr(0, tab);
+        string rest = line.substr(tab + 1);
+        if(kind == "scanned")
+            scannedFiles.insert(rest);
+        else if(kind == "depend")
+        {
+            tab = rest.find('\t');
+            if(tab != string::npos)
+                addDepend(depends, fileDataHash, rest.substr(0, tab), rest.substr(tab + 1));
+        }
+        else if(kind == "missing")
+        {
+            tab = rest.find('\t');
+            if(tab != string::npos)
+                missingIncludes[rest.substr(0, tab)].insert(rest.substr(tab + 1));
+        }
+    }
+
+    // Every file was just checked, so only the times need carrying up.
+    refreshDepends(depends, fileDataHash);
+    return true;
+}
+
 void printDepends(const list<string>& paths, const string& file)
 {
     map<FileData*, list<FileData*> > depends;
@@ -408,7 +620,7 @@ void printDepends(const list<string>& paths, const string& file)
 
 string getFilePath(string file)
 {
-    unsigned int lastSlash = file.find_last_of('/');
+    string::size_type lastSlash = file.find_last_of('/');
     if(lastSlash != string::npos)
     {
         return file.substr(0, lastSlash+1);
@@ -419,7 +631,7 @@ string getFilePath(string file)
 
 string getFileName(string file)
 {
-    unsigned int lastSlash = file.find_last_of('/');
+    string::size_type lastSlash = file.find_last_of('/');
     if(lastSlash != string::npos)
         file = file.substr(lastSlash, string::npos);
     return file;
@@ -442,7 +654,9 @@ bool mustRebuild(const string& objName, map<FileData*, list<FileData*> > depends
     //removePath(obj);
     
     time_t tObj = ioTimeModified(objName);
-    time_t tSrc = ioTimeModified(file->getPath());
+    time_t tSrc;
+    if(!getUnchangedTime(file->getPath(), tSrc))
+        tSrc = ioTimeModified(file->getPath());
     if(tObj <= tSrc)
         return true;
     
@@ -16,8 +16,12 @@ Header for pile_depend.cpp, contains FileData class definition.
 #ifndef _PILE_DEPEND_H__
 #define _PILE_DEPEND_H__
 
+#include <list>
+#include <map>
+#include <set>
 #include <string>
 #include "External Code/goodio.h"
+#include "pile_git.h"
 
 class FileData
 {
@@ -45,6 +49,13 @@ class FileData
         , dependTime(0)
     {
         setFileNameFromPath();
+        if(getUnchangedTime(fullPath, modifiedTime))
+        {
+            // Git says it has not changed since the last build.
+            fileExists = true;
+            dependTime = modifiedTime;
+            return;
+        }
         checkExistence();
         if(exists())
         {
@@ -124,7 +135,51 @@ class FileData
 
 void recurseIncludes(std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash, const std::list<std::string>& paths, const std::string& file, std::string path);
 
+void collectDepends(std::map<FileData*, std::list<FileData*> >& depends, FileData* file, std::set<FileData*>& result);
+
 bool mustRebuild(const std::string& objName, std::map<FileData*, std::list<FileData*> > depends, FileData* file);
 
+/*
+Brings an include graph that was kept from an earlier build (by piled) up to
+date.  Every file's time is checked again.  Files that changed, and the files
+that include them, are read again at the next scan.  So are files with an
+include that was missing when they were read, once it can be found.
+
+Takes: map<FileData*, list<FileData*> > (include graph)
+       map<string, FileData*> (file data, by name)
+*/
+void refreshDepends(std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+/*
+Gets every place that an include which could not be found was looked for, so
+that making one of them can be noticed.
+
+Returns: set<string> (file names)
+*/
+std::set<std::string> getMissingIncludes();
+
+/*
+Saves the include graph and which files have been scanned, so that piled can
+keep what a build found.
+
+Takes: string (file name)
+       map<FileData*, list<FileData*> > (include graph)
+       map<string, FileData*> (file data, by name)
+Returns: true if it was saved
+         false otherwise
+*/
+bool saveDepends(const std::string& file, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+/*
+Replaces the include graph with one saved by saveDepends().
+
+Takes: string (file name)
+       map<FileData*, list<FileData*> > (include graph)
+       map<string, FileData*> (file data, by name)
+Returns: true if it was loaded
+         false otherwise
+*/
+bool loadDepends(const std::string& file, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
 
 #endif
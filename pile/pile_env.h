@@ -15,17 +15,21 @@ This file contains the Environment class definition.
 #ifndef _PILE_ENV_H__
 #define _PILE_ENV_H__
 
+#include <set>
 #include <string>
 
 #include "pile_ui.h"
 #include "pile_depend.h"
 #include "pile_config.h"
+#include "pile_pch.h"
 #include "Eve Source/eve_interpreter.h"
 
 Variable* fn_scan(Variable* arg1, Variable* arg2);
 Variable* fn_build(Variable* arg1, Variable* arg2, Variable* arg3);
 Variable* fn_link(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4, Variable* arg5);
 Variable* fn_link(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4, Variable* arg5);
+Variable* fn_archive(Variable* arg1, Variable* arg2, Variable* arg3);
+Variable* fn_library(Variable* arg1, Variable* arg2, Variable* arg3, Variable* arg4);
 
 Variable* fn_codeStats(Variable* arg1, Variable* arg2);
 
@@ -47,12 +51,20 @@ class Environment
     std::list<std::string> cflags;
     std::list<std::string> lflags;
     std::list<std::string> variants;
+    std::list<std::string> targets;  // Only these outputs are built, if any are given
+    std::list<std::string> shardDirs;  // Trees whose objects are copied in by 'merge-shards'
+    std::set<std::string> shardObjects;  // The objects that 'merge-shards' copied in
+    std::string shardTimes;  // Compile times that every shard splits by, or ""
     
     std::map<std::string, std::string> variables;
     
     bool dryRun;
     bool noCompile;
     bool noLink;
+    bool emitNinja;  // Write build.ninja instead of building
+    int shard;  // The shard to compile, from 1 to shardCount
+    int shardCount;  // 0 if the build is not split
+    bool mergeShards;
     #ifndef PILE_NO_GUI
     bool autoDone;
     #endif
@@ -64,6 +76,10 @@ class Environment
         , dryRun(false)
         , noCompile(false)
         , noLink(false)
+        , emitNinja(false)
+        , shard(0)
+        , shardCount(0)
+        , mergeShards(false)
         #ifndef PILE_NO_GUI
         , autoDone(true)
         #endif
@@ -114,6 +130,11 @@ class Environment
         Class* compiler = new Class("Compiler");
         compiler->addVariable("string", "name");
         compiler->addVariable("string", "path");
+        compiler->addVariable("int", "batch_size");
+        compiler->addVariable("int", "unity");
+        compiler->addVariable("bool", "pch");
+        compiler->addVariable("int", "pch_stable_age");
+        compiler->addVariable("bool", "timing");
         Function* compile = new Function("compile", &fn_build);
         compiler->addFunction("compile", compile);
         Function* scan = new Function("scan", &fn_scan);
@@ -128,12 +149,35 @@ class Environment
             static_cast<String*>(cpp_name)->setValue(config.languages["CPP_COMPILER"]);
             static_cast<String*>(cpp_path)->setValue(config.languages["CPP_COMPILER"]);
         }
+        Variable* cpp_batch = cpp_compiler->getVariable("batch_size");
+        if(cpp_batch != NULL && cpp_batch->getType() == INT)
+            static_cast<Int*>(cpp_batch)->setValue(config.batchSize);
+        Variable* cpp_stable = cpp_compiler->getVariable("pch_stable_age");
+        if(cpp_stable != NULL && cpp_stable->getType() == INT)
+            static_cast<Int*>(cpp_stable)->setValue(PILE_PCH_STABLE_AGE);
         s.env["cpp_compiler"] = cpp_compiler;
+        ClassObject* c_compiler = new ClassObject("c_compiler", "Compiler");
+        Variable* c_name = c_compiler->getVariable("name");
+        Variable* c_path = c_compiler->getVariable("path");
+        if(c_name != NULL && c_path != NULL && c_name->getType() == STRING && c_path->getType() == STRING)
+        {
+            static_cast<String*>(c_name)->setValue(config.languages["C_COMPILER"]);
+            static_cast<String*>(c_path)->setValue(config.languages["C_COMPILER"]);
+        }
+        Variable* c_batch = c_compiler->getVariable("batch_size");
+        if(c_batch != NULL && c_batch->getType() == INT)
+            static_cast<Int*>(c_batch)->setValue(config.batchSize);
+        Variable* c_stable = c_compiler->getVariable("pch_stable_age");
+        if(c_stable != NULL && c_stable->getType() == INT)
+            static_cast<Int*>(c_stable)->setValue(PILE_PCH_STABLE_AGE);
+        s.env["c_compiler"] = c_compiler;
         
         // Linker
         Class* linker = new Class("Linker");
         linker->addVariable("string", "name");
         linker->addVariable("string", "path");
+        linker->addVariable("bool", "incremental");
+        linker->addVariable("string", "backend");
         Function* linkit = new Function("link", &fn_link);
         linker->addFunction("link", linkit);
         //s.env["Compiler"] = compiler;
@@ -146,7 +190,65 @@ class Environment
             static_cast<String*>(cpp_linkname)->setValue(config.languages["CPP_LINKER_D"]);
             static_cast<String*>(cpp_linkpath)->setValue(config.languages["CPP_LINKER_D"]);
         }
+        Variable* cpp_backend = cpp_linker->getVariable("backend");
+        if(cpp_backend != NULL && cpp_backend->getType() == STRING)
+            static_cast<String*>(cpp_backend)->setValue(config.linkerBackend);
         s.env["cpp_linker"] = cpp_linker;
+        ClassObject* c_linker = new ClassObject("c_linker", "Linker");
+        Variable* c_linkname = c_linker->getVariable("name");
+        Variable* c_linkpath = c_linker->getVariable("path");
+        if(c_linkname != NULL && c_linkpath != NULL && c_linkname->getType() == STRING && c_linkpath->getType() == STRING)
+        {
+            static_cast<String*>(c_linkname)->setValue(config.languages["C_LINKER_D"]);
+            static_cast<String*>(c_linkpath)->setValue(config.languages["C_LINKER_D"]);
+        }
+        Variable* c_backend = c_linker->getVariable("backend");
+        if(c_backend != NULL && c_backend->getType() == STRING)
+            static_cast<String*>(c_backend)->setValue(config.linkerBackend);
+        s.env["c_linker"] = c_linker;
+        
+        // Archiver (static libraries)
+        Class* archiver = new Class("Archiver");
+        archiver->addVariable("string", "name");
+        archiver->addVariable("string", "path");
+        archiver->addVariable("bool", "thin");
+        Function* archiveit = new Function("archive", &fn_archive);
+        archiver->addFunction("archive", archiveit);
+        inter.addClass(archiver);
+        ClassObject* c_archiver = new ClassObject("c_archiver", "Archiver");
+        Variable* c_arname = c_archiver->getVariable("name");
+        Variable* c_arpath = c_archiver->getVariable("path");
+        if(c_arname != NULL && c_arpath != NULL && c_arname->getType() == STRING && c_arpath->getType() == STRING)
+        {
+            static_cast<String*>(c_arname)->setValue(config.languages["C_LINKER_S"]);
+            static_cast<String*>(c_arpath)->setValue(config.languages["C_LINKER_S"]);
+        }
+        s.env["c_archiver"] = c_archiver;
+        ClassObject* cpp_archiver = new ClassObject("cpp_archiver", "Archiver");
+        Variable* cpp_arname = cpp_archiver->getVariable("name");
+        Variable* cpp_arpath = cpp_archiver->getVariable("path");
+        if(cpp_arname != NULL && cpp_arpath != NULL && cpp_arname->getType() == STRING && cpp_arpath->getType() == STRING)
+        {
+            static_cast<String*>(cpp_arname)->setValue(config.languages["CPP_LINKER_S"]);
+            static_cast<String*>(cpp_arpath)->setValue(config.languages["CPP_LINKER_S"]);
+        }
+        s.env["cpp_archiver"] = cpp_archiver;
+        
+        // Library (static and shared at once)
+        Class* library = new Class("Library");
+        library->addVariable("string", "name");
+        library->addVariable("string", "type");
+        library->addVariable("bool", "share_objects");
+        library->addVariable("string", "static_options");
+        library->addVariable("string", "shared_options");
+        library->addVariable("string", "compiler");
+        library->addVariable("string", "archiver");
+        library->addVariable("string", "linker");
+        Function* buildLibrary = new Function("build", &fn_library);
+        library->addFunction("build", buildLibrary);
+        inter.addClass(library);
+        // Pilefiles declare their own libraries, so the class has a name.
+        s.env["Library"] = library;
         
         
         // Init command line variables
@@ -0,0 +1,280 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_git.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the git change detection, which lets Pile skip checking the
+times of files that git says have not changed since the last build.
+*/
+
+#include "pile_global.h"
+#include "pile_git.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_depend.h"
+#include "pile_graph.h"
+#include "pile_system.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+bool gitChangesLoaded = false;
+string gitHead;  // The commit that is checked out
+set<string> gitTracked;  // Full paths of the files that git tracks
+set<string> gitDirty;  // Full paths of the files that differ from gitHead
+set<string> gitChanged;  // Full paths of the files that might have changed since the last build
+map<string, time_t> gitTimes;  // Saved times of the files that did not change
+
+
+/*
+Runs git and reads what it prints.  Errors are left in .pile.tmp, which is
+deleted.
+
+Takes: string (git arguments)
+       string (the output is stored here)
+Returns: true if git succeeded
+         false otherwise
+*/
+bool runGit(const string& args, string& output)
+{
+    string outfile = PILE_PROJECT_DIR "git.out";
+    int result = systemCall("(git " + args + " > " + outfile + ")");
+    ioDelete(".pile.tmp");
+
+    ifstream fin(outfile.c_str(), ios::binary);
+    stringstream str;
+    if(!fin.fail())
+        str << fin.rdbuf();
+    fin.close();
+    ioDelete(outfile.c_str());
+
+    output = str.str();
+    return (result == 0);
+}
+
+// Splits output that was printed with -z.
+vector<string> splitNulls(const string& output)
+{
+    vector<string> result;
+    string::size_type start = 0;
+    string::size_type end;
+    while((end = output.find('\0', start)) != string::npos)
+    {
+        result.push_back(output.substr(start, end - start));
+        start = end + 1;
+    }
+    if(start < output.size())
+        result.push_back(output.substr(start));
+    return result;
+}
+
+// Gets the first line of some output.
+string firstLine(const string& output)
+{
+    string::size_type end = output.find_first_of("\r\n");
+    return output.substr(0, end);
+}
+
+bool loadGitChanges()
+{
+    gitChangesLoaded = false;
+    gitTracked.clear();
+    gitDirty.clear();
+    gitChanged.clear();
+    gitTimes.clear();
+
+    mkpath(PILE_PROJECT_DIR);
+
+    string output;
+    if(!runGit("rev-parse --show-toplevel", output) || firstLine(output) == "")
+    {
+        UI_print(" Not in a git checkout, so every file will be checked.\n");
+        return false;
+    }
+    string top = addDirSlash(absolutePath(firstLine(output)));
+    string inTop = "-C " + quoteWhitespace(top) + " ";
+
+    if(!runGit("rev-parse HEAD", output) || firstLine(output) == "")
+    {
+        UI_print(" Nothing is committed yet, so every file will be checked.\n");
+        return false;
+    }
+    string head = firstLine(output);
+
+    // The index tells which files are tracked.  Files that git has been told
+    // not to look at could change without git knowing.
+    if(!runGit(inTop + "ls-files -v -z", output))
+    {
+        UI_print(" Git could not read its index, so every file will be checked.\n");
+        return false;
+    }
+    vector<string> entries = splitNulls(output);
+    for(vector<string>::iterator e = entries.begin(); e != entries.end(); e++)
+    {
+        if(e->size() < 3)
+            continue;
+        if((*e)[0] != 'H')
+        {
+            UI_print(" Git is not watching %s, so every file will be checked.\n", e->substr(2).c_str());
+            gitTracked.clear();
+            return false;
+        }
+        gitTracked.insert(top + e->substr(2));
+    }
+
+    // Each entry is "XY path".  Renames and copies are followed by the old path.
+    if(!runGit(inTop + "status --porcelain -z --untracked-files=no", output))
+    {
+        UI_print(" Git status failed, so every file will be checked.\n");
+        gitTracked.clear();
+        return false;
+    }
+    entries = splitNulls(output);
+    for(vector<string>::iterator e = entries.begin(); e != entries.end(); e++)
+    {
+        if(e->size() < 4)
+            continue;
+        string xy = e->substr(0, 2);
+        if(xy.find('U') != string::npos || xy == "AA" || xy == "DD")
+        {
+            UI_print(" A merge is in progress, so every file will be checked.\n");
+            gitTracked.clear();
+            gitDirty.clear();
+            return false;
+        }
+        gitDirty.insert(top + e->substr(3));
+        if(xy.find_first_of("RC") != string::npos && e + 1 != entries.end())
+        {
+            e++;
+            gitDirty.insert(top + *e);
+        }
+    }
+    gitChanged = gitDirty;
+
+    // Anything that was dirty at the last build or that changed between the
+    // commits might have changed since.
+    ifstream fin(PILE_GIT_STATE_FILE);
+    string oldHead;
+    string line;
+    while(!fin.fail() && getline(fin, line))
+    {
+        string::size_type space = line.find(' ');
+        if(space == string::npos)
+            continue;
+        string key = line.substr(0, space);
+        string value = line.substr(space + 1);
+        if(key == "head")
+            oldHead = value;
+        else if(key == "dirty")
+            gitChanged.insert(value);
+        else if(key == "time")
+        {
+            space = value.find(' ');
+            if(space != string::npos)
+                gitTimes[value.substr(space + 1)] = atol(value.substr(0, space).c_str());
+        }
+    }
+    fin.close();
+
+    if(oldHead != head && gitTimes.size() > 0)
+    {
+        if(oldHead == "" || !runGit(inTop + "diff --name-only -z " + oldHead + " " + head, output))
+        {
+            UI_debug_pile("Could not compare the commits %s and %s.\n", oldHead.c_str(), head.c_str());
+            gitTimes.clear();
+        }
+        else
+        {
+            entries = splitNulls(output);
+            for(vector<string>::iterator e = entries.begin(); e != entries.end(); e++)
+                gitChanged.insert(top + *e);
+        }
+    }
+
+    gitHead = head;
+    gitChangesLoaded = true;
+    UI_debug_pile("Git says %d of %d tracked files might have changed.\n", int(gitChanged.size()), int(gitTracked.size()));
+    return true;
+}
+
+bool getUnchangedTime(const string& file, time_t& time)
+{
+    if(!gitChangesLoaded)
+        return false;
+
+    string path = absolutePath(file);
+    if(gitChanged.find(path) != gitChanged.end() || gitTracked.find(path) == gitTracked.end())
+        return false;
+    map<string, time_t>::iterator e = gitTimes.find(path);
+    if(e == gitTimes.end())
+        return false;
+    time = e->second;
+    return true;
+}
+
+bool saveGitState(map<string, FileData*>& fileDataHash)
+{
+    if(!gitChangesLoaded)
+        return false;
+
+    // Times of files this build did not look at are still good if the files
+    // have not changed.
+    map<string, time_t> times;
+    for(map<string, time_t>::iterator e = gitTimes.begin(); e != gitTimes.end(); e++)
+    {
+        if(gitChanged.find(e->first) == gitChanged.end())
+            times.insert(*e);
+    }
+    for(map<string, FileData*>::iterator e = fileDataHash.begin(); e != fileDataHash.end(); e++)
+    {
+        if(e->second == NULL || !e->second->exists())
+            continue;
+        string path = absolutePath(e->first);
+        if(gitTracked.find(path) != gitTracked.end())
+            times[path] = e->second->getTime();
+    }
+
+    stringstream str;
+    str << "head " << gitHead << endl;
+    for(set<string>::iterator e = gitDirty.begin(); e != gitDirty.end(); e++)
+        str << "dirty " << *e << endl;
+    for(map<string, time_t>::iterator e = times.begin(); e != times.end(); e++)
+        str << "time " << (long)e->second << " " << e->first << endl;
+
+    mkpath(PILE_PROJECT_DIR);
+    writeIfChanged(PILE_GIT_STATE_FILE, str.str());
+    return true;
+}
+
+bool getGitChurn(int days, map<string, int>& commits)
+{
+    mkpath(PILE_PROJECT_DIR);
+    string output;
+    if(!runGit("rev-parse --show-toplevel", output) || firstLine(output) == "")
+        return false;
+    string top = addDirSlash(absolutePath(firstLine(output)));
+
+    // Each commit lists the files it changed.
+    char since[32];
+    sprintf(since, "%d", days);
+    if(!runGit("-C " + quoteWhitespace(top) + " log --format= --name-only -z --since=" + since + ".days", output))
+        return false;
+    vector<string> names = splitNulls(output);
+    for(vector<string>::iterator e = names.begin(); e != names.end(); e++)
+    {
+        string name = *e;
+        name.erase(0, name.find_first_not_of("\r\n"));
+        if(name != "")
+            commits[top + name]++;
+    }
+    return true;
+}
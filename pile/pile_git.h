@@ -0,0 +1,69 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_git.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_git.cpp
+*/
+
+#ifndef _PILE_GIT_H__
+#define _PILE_GIT_H__
+
+#include <ctime>
+#include <map>
+#include <string>
+
+class FileData;
+
+// What git said at the last build, and the times of the files it used
+#define PILE_GIT_STATE_FILE ".pile/git"
+
+/*
+Asks git which files might have changed since the last build.  Files that git
+tracks and that have not changed keep the modification times saved by the last
+build, so they are not checked again.  If git cannot tell (there is no
+checkout, a merge is in progress, or some files are marked skip-worktree or
+assume-unchanged), every file is checked like usual.
+
+Returns: true if git's answer will be used
+         false otherwise
+*/
+bool loadGitChanges();
+
+/*
+Gets the saved modification time of a file that git says has not changed.
+
+Takes: string (file name)
+       time_t (the time is stored here)
+Returns: true if the saved time can be used
+         false if the file has to be checked
+*/
+bool getUnchangedTime(const std::string& file, time_t& time);
+
+/*
+Saves git's state and the times of the tracked files for the next build.  Does
+nothing if loadGitChanges() did not succeed.
+
+Takes: map<string, FileData*> (file data)
+Returns: true on success
+         false on failure
+*/
+bool saveGitState(std::map<std::string, FileData*>& fileDataHash);
+
+/*
+Counts the commits that changed each file in the last few days.
+
+Takes: int (number of days)
+       map<string, int> (commits, by full path, are stored here)
+Returns: true on success
+         false if git can't tell (like when there is no checkout)
+*/
+bool getGitChurn(int days, std::map<std::string, int>& commits);
+
+#endif
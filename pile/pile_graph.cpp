@@ -0,0 +1,259 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_graph.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the functions which save the build graph (sources, the files
+they include, and the outputs made from them) and answer 'pile affected' from
+it.
+*/
+
+#include "pile_global.h"
+#include "pile_graph.h"
+#include "pile_ui.h"
+#include "pile_commands.h"
+#include "string_functions.h"
+#include <fstream>
+#include <set>
+
+// Sources and their objects, in the order they were compiled
+vector<pair<string, string> > graphCompiles;
+// Outputs and what went into them
+vector<pair<string, vector<string> > > graphOutputs;
+
+
+void recordCompile(const string& source, const string& object)
+{
+    graphCompiles.push_back(make_pair(source, object));
+}
+
+const vector<pair<string, string> >& getRecordedCompiles()
+{
+    return graphCompiles;
+}
+
+void recordOutput(const string& output, const vector<string>& inputs)
+{
+    graphOutputs.push_back(make_pair(output, inputs));
+}
+
+/*
+The graph file has one entry per line:
+ pilefile <file>  (once for each pilefile that was read)
+ source <file>
+  object <file>
+  include <file>
+ output <file>
+  input <file>
+Files inside the project are relative to it, so that every checkout has the
+same graph.
+*/
+bool writeGraph(const list<string>& pilefiles, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    string root = ioGetCWD();
+    mkpath(PILE_PROJECT_DIR);
+    ofstream fout(PILE_GRAPH_FILE, ios::trunc);
+    if(fout.fail())
+    {
+        UI_warning("Warning: Could not write %s\n", PILE_GRAPH_FILE);
+        return false;
+    }
+
+    set<string> written;
+    for(list<string>::const_iterator e = pilefiles.begin(); e != pilefiles.end(); e++)
+    {
+        string pilefile = relativeToDir(root, absolutePath(*e));
+        if(written.insert(pilefile).second)
+            fout << "pilefile " << pilefile << endl;
+    }
+    written.clear();
+    for(vector<pair<string, string> >::iterator e = graphCompiles.begin(); e != graphCompiles.end(); e++)
+    {
+        if(!written.insert(e->second).second)
+            continue;
+        fout << "source " << relativeToDir(root, absolutePath(e->first)) << endl;
+        fout << " object " << relativeToDir(root, absolutePath(e->second)) << endl;
+
+        map<string, FileData*>::iterator fd = fileDataHash.find(e->first);
+        if(fd == fileDataHash.end() || fd->second == NULL)
+            continue;
+        set<FileData*> includes;
+        collectDepends(depends, fd->second, includes);
+        for(set<FileData*>::iterator f = includes.begin(); f != includes.end(); f++)
+        {
+            // Headers that could not be found are system headers.
+            if((*f)->exists())
+                fout << " include " << relativeToDir(root, absolutePath((*f)->getPath())) << endl;
+        }
+    }
+
+    for(vector<pair<string, vector<string> > >::iterator e = graphOutputs.begin(); e != graphOutputs.end(); e++)
+    {
+        fout << "output " << relativeToDir(root, absolutePath(e->first)) << endl;
+        for(vector<string>::iterator f = e->second.begin(); f != e->second.end(); f++)
+            fout << " input " << relativeToDir(root, absolutePath(*f)) << endl;
+    }
+
+    UI_debug_pile("Wrote the build graph to %s\n", PILE_GRAPH_FILE);
+    return true;
+}
+
+bool readGraphSources(vector<pair<string, string> >& sources, map<string, vector<string> >& includes)
+{
+    ifstream fin(PILE_GRAPH_FILE);
+    if(fin.fail())
+        return false;
+
+    string line;
+    string source;
+    while(getline(fin, line))
+    {
+        if(line.size() > 0 && line[line.size()-1] == '\r')
+            line.erase(line.size()-1);
+        string::size_type space = line.find(' ', (line.size() > 0 && line[0] == ' '? 1 : 0));
+        if(space == string::npos)
+            continue;
+        string key = line.substr(0, space);
+        string value = line.substr(space + 1);
+
+        if(key == "source")
+            source = value;
+        else if(key == " object")
+        {
+            sources.push_back(make_pair(source, value));
+            includes[value];
+        }
+        else if(key == " include" && sources.size() > 0)
+            includes[sources.back().second].push_back(value);
+    }
+    return true;
+}
+
+bool printAffected(const list<string>& files)
+{
+    ifstream fin(PILE_GRAPH_FILE);
+    if(fin.fail())
+    {
+        UI_error("pile error: There is no build graph here yet.  Build once to make %s.\n", PILE_GRAPH_FILE);
+        return false;
+    }
+
+    set<string> changed;
+    for(list<string>::const_iterator e = files.begin(); e != files.end(); e++)
+        changed.insert(absolutePath(*e));
+
+    // Read the graph and check each source as it goes by.
+    vector<pair<string, string> > sources;  // Each source and its object
+    set<string> affectedSources;
+    set<string> affectedFiles;  // Full paths of affected objects and outputs
+    vector<pair<string, vector<string> > > outputs;
+    bool everything = false;
+
+    string line;
+    string source;
+    string object;
+    while(getline(fin, line))
+    {
+        if(line.size() > 0 && line[line.size()-1] == '\r')
+            line.erase(line.size()-1);
+        string::size_type space = line.find(' ', (line.size() > 0 && line[0] == ' '? 1 : 0));
+        if(space == string::npos)
+            continue;
+        string key = line.substr(0, space);
+        string value = line.substr(space + 1);
+
+        if(key == "pilefile")
+        {
+            if(changed.find(absolutePath(value)) != changed.end())
+                everything = true;
+        }
+        else if(key == "source")
+        {
+            source = value;
+            if(changed.find(absolutePath(value)) != changed.end())
+                affectedSources.insert(value);
+        }
+        else if(key == " object")
+        {
+            object = value;
+            sources.push_back(make_pair(source, object));
+            if(changed.find(absolutePath(value)) != changed.end())
+                affectedFiles.insert(absolutePath(value));
+        }
+        else if(key == " include")
+        {
+            if(changed.find(absolutePath(value)) != changed.end())
+                affectedSources.insert(source);
+        }
+        else if(key == "output")
+            outputs.push_back(make_pair(value, vector<string>()));
+        else if(key == " input" && outputs.size() > 0)
+            outputs.back().second.push_back(value);
+
+        if(key == " object" || key == " include")
+        {
+            if(affectedSources.find(source) != affectedSources.end())
+                affectedFiles.insert(absolutePath(object));
+        }
+    }
+
+    if(everything)
+    {
+        for(vector<pair<string, string> >::iterator e = sources.begin(); e != sources.end(); e++)
+        {
+            affectedSources.insert(e->first);
+            affectedFiles.insert(absolutePath(e->second));
+        }
+        for(vector<pair<string, vector<string> > >::iterator e = outputs.begin(); e != outputs.end(); e++)
+            affectedFiles.insert(absolutePath(e->first));
+    }
+
+    // An output is affected by any of its inputs, including other outputs
+    // (like a library).
+    vector<string> affectedOutputs;
+    set<string> done;
+    bool more = true;
+    while(more)
+    {
+        more = false;
+        for(vector<pair<string, vector<string> > >::iterator e = outputs.begin(); e != outputs.end(); e++)
+        {
+            string out = absolutePath(e->first);
+            if(done.find(out) != done.end())
+                continue;
+            bool affected = (affectedFiles.find(out) != affectedFiles.end() || changed.find(out) != changed.end());
+            for(vector<string>::iterator f = e->second.begin(); !affected && f != e->second.end(); f++)
+            {
+                string in = absolutePath(*f);
+                affected = (affectedFiles.find(in) != affectedFiles.end() || changed.find(in) != changed.end());
+            }
+            if(affected)
+            {
+                done.insert(out);
+                affectedFiles.insert(out);
+                affectedOutputs.push_back(e->first);
+                more = true;
+            }
+        }
+    }
+
+    for(vector<pair<string, string> >::iterator e = sources.begin(); e != sources.end(); e++)
+    {
+        if(affectedSources.erase(e->first) > 0)
+            UI_print("source %s\n", e->first.c_str());
+    }
+    for(vector<pair<string, string> >::iterator e = sources.begin(); e != sources.end(); e++)
+    {
+        if(affectedFiles.find(absolutePath(e->second)) != affectedFiles.end())
+            UI_print("object %s\n", e->second.c_str());
+    }
+    for(vector<string>::iterator e = affectedOutputs.begin(); e != affectedOutputs.end(); e++)
+        UI_print("output %s\n", e->c_str());
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_graph.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_graph.cpp
+*/
+
+#ifndef _PILE_GRAPH_H__
+#define _PILE_GRAPH_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "pile_depend.h"
+
+// Where Pile keeps what it knows about the project, beside the pilefile
+#define PILE_PROJECT_DIR ".pile/"
+
+// The build graph, saved after every build for 'pile affected'
+#define PILE_GRAPH_FILE ".pile/graph"
+
+/*
+Remembers that a source is compiled into an object, for the saved graph.
+
+Takes: string (source file name)
+       string (object file name)
+*/
+void recordCompile(const std::string& source, const std::string& object);
+
+/*
+Gets the sources and objects recorded so far, in the order they were compiled.
+
+Returns: vector<pair<string, string> > (source and object file names)
+*/
+const std::vector<std::pair<std::string, std::string> >& getRecordedCompiles();
+
+/*
+Remembers what an output (like a program or library) is made from, for the
+saved graph.
+
+Takes: string (output file name)
+       vector<string> (objects and libraries that go into it)
+*/
+void recordOutput(const std::string& output, const std::vector<std::string>& inputs);
+
+/*
+Saves the sources, the files they include, and the outputs that were recorded
+during this build.  A change to any of the files that were read to set up the
+build (pile.conf, the pilefile, and every file that it include()s) affects
+everything.
+
+Takes: list<string> (those files)
+       map<FileData*, list<FileData*> > (dependencies)
+       map<string, FileData*> (file data)
+Returns: true on success
+         false on failure
+*/
+bool writeGraph(const std::list<std::string>& pilefiles, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+/*
+Reads the sources in the saved graph, with their objects and the files that
+they include.
+
+Takes: vector<pair<string, string> > (each source and its object are stored
+                                      here)
+       map<string, vector<string> > (the files that each source includes are
+                                     stored here, by object)
+Returns: true on success
+         false if there is no saved graph
+*/
+bool readGraphSources(std::vector<std::pair<std::string, std::string> >& sources, std::map<std::string, std::vector<std::string> >& includes);
+
+/*
+Prints the sources, objects, and outputs that changes to the given files
+affect, using the saved graph.  Nothing is scanned or built.
+
+Takes: list<string> (changed file names)
+Returns: true on success
+         false if there is no saved graph
+*/
+bool printAffected(const std::list<std::string>& files);
+
+#endif
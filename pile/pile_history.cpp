@@ -0,0 +1,264 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_history.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the build history, which is added to after every build,
+and 'pile history', which shows how builds have been going.  How long each
+object usually takes to compile is kept with the compile times (pile_shard.cpp)
+instead, so that a build never has to read the history.
+
+Each build is a few lines at the end of the history:
+ build <time> <ok|failed> <milliseconds> <peak KB> <cache hits> <cache misses>
+  phase <milliseconds> <name>
+  job <milliseconds> <peak KB> <ok|failed> <name>
+  compiler <sources> <parsing ms> <templates ms> <optimizing ms>
+  header <milliseconds> <name>
+The compiler and header lines are only there when compilers reported their
+time.
+*/
+
+#include "pile_global.h"
+#include "pile_history.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_graph.h"
+#include "pile_shard.h"
+#include "pile_stats.h"
+#include "pile_system.h"
+#include "pile_timing.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+// A job from the history
+struct JobRecord
+{
+    string name;
+    unsigned long milliseconds;
+    long memoryKB;
+    bool success;
+};
+
+// A build from the history
+struct BuildRecord
+{
+    time_t when;
+    bool success;
+    unsigned long milliseconds;
+    long memoryKB;
+    unsigned long cacheHits;
+    unsigned long cacheMisses;
+    vector<pair<string, unsigned long> > phases;
+    vector<JobRecord> jobs;
+    CompilerTiming compiler;
+};
+
+vector<JobRecord> jobHistory;  // The jobs of this build
+
+
+void recordJobHistory(const string& name, unsigned long milliseconds, long memoryKB, bool success)
+{
+    JobRecord job;
+    job.name = name;
+    job.milliseconds = milliseconds;
+    job.memoryKB = memoryKB;
+    job.success = success;
+    jobHistory.push_back(job);
+}
+
+// Reads every build in the history, oldest first.
+bool readHistory(vector<BuildRecord>& builds)
+{
+    ifstream fin(PILE_HISTORY_FILE);
+    if(fin.fail())
+        return false;
+
+    string line;
+    while(getline(fin, line))
+    {
+        stringstream str(line);
+        string key;
+        str >> key;
+        if(key == "build")
+        {
+            BuildRecord build;
+            long when = 0;
+            string outcome;
+            str >> when >> outcome >> build.milliseconds >> build.memoryKB >> build.cacheHits >> build.cacheMisses;
+            if(str.fail())
+                continue;
+            build.when = when;
+            build.success = (outcome == "ok");
+            builds.push_back(build);
+        }
+        else if(key == "phase" && builds.size() > 0)
+        {
+            unsigned long milliseconds = 0;
+            string name;
+            str >> milliseconds;
+            getline(str >> ws, name);
+            builds.back().phases.push_back(make_pair(name, milliseconds));
+        }
+        else if(key == "job" && builds.size() > 0)
+        {
+            JobRecord job;
+            string outcome;
+            str >> job.milliseconds >> job.memoryKB >> outcome;
+            getline(str >> ws, job.name);
+            if(job.name == "")
+                continue;
+            job.success = (outcome == "ok");
+            builds.back().jobs.push_back(job);
+        }
+        else if(key == "compiler" && builds.size() > 0)
+        {
+            CompilerTiming& c = builds.back().compiler;
+            str >> c.sources >> c.parsing >> c.templates >> c.optimizing;
+            if(str.fail())
+                c = CompilerTiming();
+        }
+        else if(key == "header" && builds.size() > 0)
+        {
+            unsigned long milliseconds = 0;
+            string name;
+            str >> milliseconds;
+            getline(str >> ws, name);
+            if(name != "")
+                builds.back().compiler.headers[name] = milliseconds;
+        }
+    }
+    return true;
+}
+
+bool appendBuildHistory(bool success)
+{
+    long memoryKB = getPeakMemoryKB();
+    for(vector<JobRecord>::iterator e = jobHistory.begin(); e != jobHistory.end(); e++)
+        memoryKB = max(memoryKB, e->memoryKB);
+
+    stringstream str;
+    str << "build " << long(time(NULL)) << (success? " ok " : " failed ") << getRunMilliseconds() << " " << memoryKB
+        << " " << statCounters[STAT_CACHE_HITS] << " " << statCounters[STAT_CACHE_MISSES] << endl;
+    const vector<pair<string, unsigned long> >& phases = getPhaseTimes();
+    for(vector<pair<string, unsigned long> >::const_iterator e = phases.begin(); e != phases.end(); e++)
+        str << " phase " << e->second << " " << e->first << endl;
+    for(vector<JobRecord>::iterator e = jobHistory.begin(); e != jobHistory.end(); e++)
+        str << " job " << e->milliseconds << " " << e->memoryKB << (e->success? " ok " : " failed ") << e->name << endl;
+    const CompilerTiming& compiler = getCompilerTiming();
+    if(compiler.sources > 0)
+    {
+        str << " compiler " << compiler.sources << " " << compiler.parsing << " " << compiler.templates << " " << compiler.optimizing << endl;
+        vector<pair<unsigned long, string> > headers = getSlowestHeaders(compiler);
+        for(unsigned int i = 0; i < headers.size() && i < PILE_TIMING_HEADERS; i++)
+            str << " header " << headers[i].first << " " << headers[i].second << endl;
+    }
+
+    mkpath(PILE_PROJECT_DIR);
+    if(!ioAppend(str.str(), PILE_HISTORY_FILE))
+    {
+        UI_warning("Warning: Could not write %s\n", PILE_HISTORY_FILE);
+        return false;
+    }
+    return true;
+}
+
+// Gets an average build time, in milliseconds.
+unsigned long averageBuildTime(vector<BuildRecord>::const_iterator begin, vector<BuildRecord>::const_iterator end)
+{
+    unsigned long total = 0;
+    int count = 0;
+    for(vector<BuildRecord>::const_iterator e = begin; e != end; e++, count++)
+        total += e->milliseconds;
+    return (count > 0? total / count : 0);
+}
+
+bool printHistory(int count)
+{
+    vector<BuildRecord> builds;
+    if(!readHistory(builds) || builds.size() == 0)
+    {
+        UI_error("pile error: There is no build history here yet.\n");
+        return false;
+    }
+    if(count < 1)
+        count = 1;
+
+    UI_print("Last builds:\n");
+    unsigned int first = (builds.size() > (unsigned int)count? builds.size() - count : 0);
+    for(unsigned int i = first; i < builds.size(); i++)
+    {
+        const BuildRecord& b = builds[i];
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&b.when));
+        unsigned long lookups = b.cacheHits + b.cacheMisses;
+        UI_print(" %s  %-6s  %6.1f s  %4d jobs  %5ld MB peak", when, (b.success? "ok" : "failed"), b.milliseconds/1000.0f, int(b.jobs.size()), b.memoryKB/1024);
+        if(lookups > 0)
+            UI_print("  %lu%% from the cache", b.cacheHits*100/lookups);
+        UI_print("\n");
+    }
+
+    // Compare the latest builds with the ones before them.
+    unsigned int span = min((unsigned int)PILE_HISTORY_BASELINE, (unsigned int)builds.size()/2);
+    if(span > 0)
+    {
+        vector<BuildRecord>::const_iterator end = builds.end();
+        unsigned long latest = averageBuildTime(end - span, end);
+        unsigned long before = averageBuildTime(end - 2*span, end - span);
+        UI_print("\nThe last %d builds took %.1f s on average, and the %d before them took %.1f s.\n", span, latest/1000.0f, span, before/1000.0f);
+    }
+
+    // Slowest sources, by how long they usually take.  The times are kept by
+    // object, so the saved graph gives their sources.
+    map<string, unsigned long> times;
+    readCompileTimes(times);
+    vector<pair<string, string> > sources;
+    map<string, vector<string> > includes;
+    map<string, string> sourceOf;
+    readGraphSources(sources, includes);
+    for(vector<pair<string, string> >::iterator e = sources.begin(); e != sources.end(); e++)
+        sourceOf[absolutePath(e->second)] = e->first;
+    vector<pair<unsigned long, string> > slowest;
+    for(map<string, unsigned long>::iterator e = times.begin(); e != times.end(); e++)
+    {
+        map<string, string>::iterator s = sourceOf.find(absolutePath(e->first));
+        slowest.push_back(make_pair(e->second, (s == sourceOf.end()? e->first : s->second)));
+    }
+    sort(slowest.rbegin(), slowest.rend());
+    if(slowest.size() > 0)
+    {
+        UI_print("\nSlowest sources to compile (middle of the last %d times):\n", PILE_HISTORY_BASELINE);
+        for(unsigned int i = 0; i < slowest.size() && i < 10; i++)
+            UI_print(" %7lu ms  %s\n", slowest[i].first, slowest[i].second.c_str());
+    }
+
+    // Where the compilers' time went, from the last build that timed them
+    for(vector<BuildRecord>::const_reverse_iterator e = builds.rbegin(); e != builds.rend(); e++)
+    {
+        const CompilerTiming& c = e->compiler;
+        if(c.sources == 0)
+            continue;
+        UI_print("\nCompiler time in the last timed build (%d sources):\n", c.sources);
+        UI_print(" %7.1f s  parsing\n", c.parsing/1000.0f);
+        UI_print(" %7.1f s  of that, instantiating templates\n", c.templates/1000.0f);
+        UI_print(" %7.1f s  optimizing and generating code\n", c.optimizing/1000.0f);
+        vector<pair<unsigned long, string> > headers = getSlowestHeaders(c);
+        if(headers.size() > 0)
+        {
+            UI_print("\nHeaders that took longest to parse, summed over the sources:\n");
+            for(unsigned int i = 0; i < headers.size() && i < 10; i++)
+                UI_print(" %7lu ms  %s\n", headers[i].first, headers[i].second.c_str());
+        }
+        break;
+    }
+    return true;
+}
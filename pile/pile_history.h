@@ -0,0 +1,64 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_history.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_history.cpp
+*/
+
+#ifndef _PILE_HISTORY_H__
+#define _PILE_HISTORY_H__
+
+#include <string>
+
+// Every build of the project, added to the end after each one
+#define PILE_HISTORY_FILE ".pile/history"
+
+// How many of the latest builds are compared with the ones before them, and
+// how many compile times of each object are kept to compare with
+#define PILE_HISTORY_BASELINE 5
+
+// How much slower a compile has to get to be warned about, in percent
+#define PILE_HISTORY_SLOWER_PERCENT 50
+
+// Compiles faster than this (in milliseconds) are too noisy to warn about
+#define PILE_HISTORY_MIN_MS 250
+
+/*
+Remembers how long a job's command took, for the history.
+
+Takes: string (job name, like a source or an output)
+       unsigned long (milliseconds)
+       long (peak memory of the command, in KB)
+       bool (true if it succeeded)
+*/
+void recordJobHistory(const std::string& name, unsigned long milliseconds, long memoryKB, bool success);
+
+/*
+Adds this build to the history: how long each phase and job took, the peak
+memory, the cache hits and misses, and whether it worked.  The history is only
+added to, never read, so this costs the same however long it gets.
+
+Takes: bool (true if the build succeeded)
+Returns: true on success
+         false if the history could not be written
+*/
+bool appendBuildHistory(bool success);
+
+/*
+Prints the last builds, how the build time is trending, and the sources that
+take longest to compile, for 'pile history'.
+
+Takes: int (number of builds to list)
+Returns: true on success
+         false if there is no history
+*/
+bool printHistory(int builds);
+
+#endif
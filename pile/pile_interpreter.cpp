@@ -14,12 +14,28 @@ This file contains the interpreter interface.
 
 #include "pile_global.h"
 #include "pile_env.h"
+#include "pile_trace.h"
 #include "Eve Source/eve_interpreter.h"
 
 
 Interpreter interpreter;
 
 
+// Puts the files that the interpreter reads and the functions it calls into
+// the trace.
+void traceInterpreterEnter(const string& kind, const string& name)
+{
+    if(kind == "file")
+        traceBegin("Reading " + name, "pilefile");
+    else
+        traceBegin(name + "()", "call");
+}
+
+void traceInterpreterLeave()
+{
+    traceEnd();
+}
+
 
 bool interpretNoPile(string filename, Environment& env, Configuration& config)
 {
@@ -38,6 +54,11 @@ bool interpret(string filename, Environment& env, Configuration& config)
 {
     // Put Pile variables into the interpreter.
     env.initInterpreter(interpreter, config);
+    if(tracing())
+    {
+        interpreter.onEnter = traceInterpreterEnter;
+        interpreter.onLeave = traceInterpreterLeave;
+    }
     
     if(!interpreter.readFile(filename))
         return false;
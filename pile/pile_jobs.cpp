@@ -0,0 +1,456 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_jobs.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the job scheduler, which runs the commands of the build in
+parallel while keeping them in dependency order.
+*/
+
+#include "pile_global.h"
+#include "pile_jobs.h"
+#include "pile_history.h"
+#include "pile_stats.h"
+#include "pile_system.h"
+#include "pile_trace.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+list<Job*> jobs;
+map<string, Job*> producers;
+multimap<string, Job*> targetNames;
+int freeSlots = 1;
+
+
+void Job::dependOn(const string& file)
+{
+    Job* job = getProducer(file);
+    if(job != NULL && job != this && find(depends.begin(), depends.end(), job) == depends.end())
+        depends.push_back(job);
+}
+
+void addJob(Job* job)
+{
+    if(job != NULL)
+        jobs.push_back(job);
+}
+
+void setProducer(const string& file, Job* job)
+{
+    producers[file] = job;
+}
+
+Job* getProducer(const string& file)
+{
+    map<string, Job*>::iterator e = producers.find(file);
+    if(e == producers.end())
+        return NULL;
+    return e->second;
+}
+
+void addTargetName(const string& name, Job* job)
+{
+    targetNames.insert(make_pair(name, job));
+}
+
+// Marks a job and everything it needs.
+void markNeeded(Job* job, set<Job*>& needed)
+{
+    if(job == NULL || !needed.insert(job).second)
+        return;
+    for(list<Job*>::iterator e = job->depends.begin(); e != job->depends.end(); e++)
+        markNeeded(*e, needed);
+}
+
+// Deletes the jobs that are not needed and forgets what they would make.
+void dropUnneeded(const set<Job*>& needed)
+{
+    for(list<Job*>::iterator e = jobs.begin(); e != jobs.end();)
+    {
+        if(needed.find(*e) == needed.end())
+        {
+            delete *e;
+            e = jobs.erase(e);
+        }
+        else
+            e++;
+    }
+
+    for(map<string, Job*>::iterator e = producers.begin(); e != producers.end();)
+    {
+        if(needed.find(e->second) == needed.end())
+            producers.erase(e++);
+        else
+            e++;
+    }
+    for(multimap<string, Job*>::iterator e = targetNames.begin(); e != targetNames.end();)
+    {
+        if(e->second != NULL && needed.find(e->second) == needed.end())
+            targetNames.erase(e++);
+        else
+            e++;
+    }
+}
+
+bool selectTargets(const list<string>& targets)
+{
+    bool result = true;
+    set<Job*> needed;
+    string cwd = addDirSlash(ioGetCWD());
+    for(list<string>::const_iterator t = targets.begin(); t != targets.end(); t++)
+    {
+        string name = *t;
+        if(name.substr(0, cwd.size()) == cwd)
+            name = name.substr(cwd.size());
+        while(name.substr(0, 2) == "./")
+            name = name.substr(2);
+
+        bool found = false;
+        map<string, Job*>::iterator p = producers.find(name);
+        if(p != producers.end())
+        {
+            markNeeded(p->second, needed);
+            found = true;
+        }
+        for(multimap<string, Job*>::iterator e = targetNames.lower_bound(name); e != targetNames.upper_bound(name); e++)
+        {
+            markNeeded(e->second, needed);
+            found = true;
+        }
+
+        if(!found)
+        {
+            UI_error("pile error: Nothing in the pilefile makes %s.\n", t->c_str());
+            result = false;
+        }
+    }
+
+    dropUnneeded(needed);
+    if(jobs.size() == 0 && result)
+        UI_print(" Everything asked for is up to date.\n");
+    return result;
+}
+
+int keepJobsFor(const list<string>& files)
+{
+    set<Job*> needed;
+    for(list<string>::const_iterator e = files.begin(); e != files.end(); e++)
+        markNeeded(getProducer(*e), needed);
+    dropUnneeded(needed);
+    return jobs.size();
+}
+
+void dropJobsFor(const set<string>& files)
+{
+    set<Job*> dropped;
+    for(set<string>::const_iterator e = files.begin(); e != files.end(); e++)
+    {
+        Job* job = getProducer(*e);
+        if(job != NULL)
+            dropped.insert(job);
+    }
+    if(dropped.size() == 0)
+        return;
+
+    set<Job*> needed;
+    for(list<Job*>::iterator e = jobs.begin(); e != jobs.end(); e++)
+    {
+        if(dropped.find(*e) != dropped.end())
+            continue;
+        needed.insert(*e);
+        for(list<Job*>::iterator d = (*e)->depends.begin(); d != (*e)->depends.end();)
+        {
+            if(dropped.find(*d) != dropped.end())
+                d = (*e)->depends.erase(d);
+            else
+                d++;
+        }
+    }
+    dropUnneeded(needed);
+}
+
+int getFreeJobSlots()
+{
+    if(freeSlots < 1)
+        return 1;
+    return freeSlots;
+}
+
+void clearJobs()
+{
+    for(list<Job*>::iterator e = jobs.begin(); e != jobs.end(); e++)
+        delete *e;
+    jobs.clear();
+    producers.clear();
+    targetNames.clear();
+}
+
+string numberText(long number)
+{
+    char buff[32];
+    sprintf(buff, "%ld", number);
+    return buff;
+}
+
+// Adds the jobs that take over from a finished job to the ones waiting.
+void takeFollowUps(Job* job, list<Job*>& waiting)
+{
+    for(list<Job*>::iterator f = job->followUps.begin(); f != job->followUps.end(); f++)
+    {
+        // Anything that needs the job needs these too.
+        for(list<Job*>::iterator e = jobs.begin(); e != jobs.end(); e++)
+        {
+            if(find((*e)->depends.begin(), (*e)->depends.end(), job) != (*e)->depends.end())
+                (*e)->depends.push_back(*f);
+        }
+        addJob(*f);
+        waiting.push_back(*f);
+    }
+    job->followUps.clear();
+}
+
+// A job whose command is running
+struct RunningJob
+{
+    Job* job;
+    string outputFile;
+    int worker;  // Index of its worker slot, or -1 if it runs here
+    int lane;  // Where it is shown in the trace
+    unsigned long long started;  // Trace time, in microseconds
+    string command;
+};
+
+bool runJobs(int slots, const list<string>& workers)
+{
+    if(slots < 1)
+        slots = 1;
+
+    vector<string> workerSlots(workers.begin(), workers.end());
+    vector<bool> workerBusy(workerSlots.size(), false);
+    vector<bool> localBusy(slots, false);
+    int localRunning = 0;
+    int remoteRunning = 0;
+
+    list<Job*> waiting = jobs;
+    map<int, RunningJob> running;
+    list<string> failed;
+    bool quit = false;
+    int nextFile = 0;
+
+    while(waiting.size() > 0 || running.size() > 0)
+    {
+        // Start everything that is ready, in the order it was added.
+        bool changed = true;
+        while(changed && !quit)
+        {
+            changed = false;
+            for(list<Job*>::iterator e = waiting.begin(); e != waiting.end() && (localRunning < slots || remoteRunning < int(workerSlots.size()));)
+            {
+                Job* job = *e;
+                bool ready = true;
+                bool blocked = false;
+                for(list<Job*>::iterator d = job->depends.begin(); d != job->depends.end(); d++)
+                {
+                    if(!(*d)->finished)
+                        ready = false;
+                    else if(!(*d)->succeeded)
+                        blocked = true;
+                }
+
+                if(blocked)
+                {
+                    UI_print(" Skipping %s because something it needs failed.\n", job->getName().c_str());
+                    countStat(STAT_JOBS_SKIPPED);
+                    job->finished = true;
+                    e = waiting.erase(e);
+                    changed = true;
+                    continue;
+                }
+                if(!ready)
+                {
+                    e++;
+                    continue;
+                }
+
+                // Local slots are used first.  Remote ones are extra.
+                int worker = -1;
+                if(localRunning >= slots)
+                {
+                    if(job->canRunRemotely())
+                    {
+                        for(unsigned int w = 0; w < workerBusy.size() && worker < 0; w++)
+                        {
+                            if(!workerBusy[w])
+                                worker = w;
+                        }
+                    }
+                    if(worker < 0)
+                    {
+                        e++;
+                        continue;
+                    }
+                }
+
+                e = waiting.erase(e);
+                changed = true;
+
+                freeSlots = slots - localRunning;
+                job->worker = (worker < 0? "" : workerSlots[worker]);
+                unsigned long long checked = traceTime();
+                string command = job->start();
+                if(tracing())
+                    traceSpan("Checking " + job->getName(), "check", 0, checked, map<string, string>());
+                if(command == "")
+                {
+                    countStat(STAT_JOBS_SKIPPED);
+                    job->succeeded = job->finish(true);
+                    job->finished = true;
+                    // A job with nothing to run can still fail to finish,
+                    // like a copy that could not be made.
+                    if(!job->succeeded)
+                    {
+                        countStat(STAT_JOBS_FAILED);
+                        failed.push_back(job->getName());
+                    }
+                    takeFollowUps(job, waiting);
+                    continue;
+                }
+
+                char buff[32];
+                sprintf(buff, ".pile.tmp.%d", nextFile++);
+                string outputFile = buff;
+
+                UI_debug_pile("Actual call:\n %s\n", command.c_str());
+                countStat(STAT_JOBS_RUN);
+                int id = startCommand(command, outputFile);
+                if(id < 0)
+                {
+                    UI_error("Could not run: %s\n", command.c_str());
+                    job->succeeded = job->finish(false);
+                    job->finished = true;
+                    if(!job->succeeded)
+                    {
+                        countStat(STAT_JOBS_FAILED);
+                        failed.push_back(job->getName());
+                    }
+                    takeFollowUps(job, waiting);
+                    continue;
+                }
+                RunningJob r;
+                r.job = job;
+                r.outputFile = outputFile;
+                r.worker = worker;
+                r.started = traceTime();
+                r.command = command;
+                if(worker < 0)
+                {
+                    // Each local slot gets a lane, then each worker.
+                    r.lane = 1;
+                    while(localBusy[r.lane - 1])
+                        r.lane++;
+                    localBusy[r.lane - 1] = true;
+                    localRunning++;
+                    nameTraceLane(r.lane, "slot " + numberText(r.lane));
+                }
+                else
+                {
+                    r.lane = slots + 1 + worker;
+                    workerBusy[worker] = true;
+                    remoteRunning++;
+                    nameTraceLane(r.lane, "worker " + workerSlots[worker]);
+                }
+                running[id] = r;
+            }
+        }
+
+        if(running.size() == 0)
+        {
+            // Whatever is left can never start.
+            if(waiting.size() > 0 && !quit)
+                UI_error("Some jobs could not be started.\n");
+            break;
+        }
+
+        int result = 0;
+        CommandUsage usage;
+        int id = waitForCommand(result, usage);
+        map<int, RunningJob>::iterator r = running.find(id);
+        if(r == running.end())
+        {
+            if(id < 0)
+                break;
+            continue;
+        }
+
+        Job* job = r->second.job;
+        map<string, string> args;
+        job->readOutput(r->second.outputFile, args);
+        if(job->showOutput(result == 0))
+            UI_print_file(r->second.outputFile);
+        ioDelete(r->second.outputFile.c_str());
+        recordJobHistory(job->getName(), (traceTime() - r->second.started)/1000, usage.maxMemoryKB, result == 0);
+        if(tracing())
+        {
+            args["command"] = r->second.command;
+            args["exit code"] = numberText(result);
+            args["user ms"] = numberText(long(usage.userMilliseconds));
+            args["system ms"] = numberText(long(usage.systemMilliseconds));
+            args["max RSS KB"] = numberText(long(usage.maxMemoryKB));
+            traceSpan(job->getName(), "job", r->second.lane, r->second.started, args);
+        }
+        if(r->second.worker < 0)
+        {
+            localBusy[r->second.lane - 1] = false;
+            localRunning--;
+        }
+        else
+        {
+            workerBusy[r->second.worker] = false;
+            remoteRunning--;
+        }
+        running.erase(r);
+
+        job->succeeded = job->finish(result == 0);
+        job->finished = true;
+        if(!job->succeeded)
+        {
+            countStat(STAT_JOBS_FAILED);
+            failed.push_back(job->getName());
+        }
+        takeFollowUps(job, waiting);
+
+        if(UI_processEvents() < 0)
+            quit = true;
+        UI_updateScreen();
+    }
+
+    bool allDone = (failed.size() == 0 && !quit);
+    for(list<Job*>::iterator e = jobs.begin(); e != jobs.end(); e++)
+    {
+        if(!(*e)->finished)
+            allDone = false;
+    }
+
+    if(failed.size() > 0)
+    {
+        UI_error("Some files failed to build:\n");
+        for(list<string>::iterator e = failed.begin(); e != failed.end(); e++)
+        {
+            UI_error("  %s\n", e->c_str());
+        }
+        UI_error("\n");
+    }
+
+    clearJobs();
+    return allDone;
+}
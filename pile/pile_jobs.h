@@ -0,0 +1,198 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_jobs.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_jobs.cpp, contains the Job class definition.
+*/
+
+#ifndef _PILE_JOBS_H__
+#define _PILE_JOBS_H__
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+/*
+One step of the build, like compiling a source or linking a program.  A job
+waits for the jobs it depends on, then runs a single command.  Jobs are added
+while the pilefile is read and run together afterward by runJobs().
+*/
+class Job
+{
+    public:
+    std::list<Job*> depends;
+    bool finished;
+    bool succeeded;
+    std::string worker;  // The pile-worker to run on, or "" to run here
+    // Jobs that take over from this one when it finishes, like compiling the
+    // files of a failed batch one at a time.  Whatever depends on this job
+    // waits for them too.  runJobs() takes them over.
+    std::list<Job*> followUps;
+
+    Job()
+        : finished(false)
+        , succeeded(false)
+    {}
+
+    virtual ~Job()
+    {}
+
+    /*
+    Gets ready to run.  This is called once all of the dependencies have
+    succeeded, so it can look at their outputs.
+
+    Returns: string (the command to run, or "" if there is nothing to do)
+    */
+    virtual std::string start() = 0;
+
+    /*
+    Tells whether the command can be sent to a pile-worker.  runJobs() sets
+    'worker' before start() when it does that.
+
+    Returns: true if it can
+             false if it has to run here
+    */
+    virtual bool canRunRemotely()
+    {
+        return false;
+    }
+
+    /*
+    Looks at the command's output before it is printed.  It may change the
+    output, and it can add details about the command for the trace.
+
+    Takes: string (file with the output)
+           map<string, string> (details are stored here)
+    */
+    virtual void readOutput(const std::string& outputFile, std::map<std::string, std::string>& details)
+    {}
+
+    /*
+    Tells whether the command's output should be printed.
+
+    Takes: bool (true if the command succeeded)
+    Returns: true if it should
+             false otherwise
+    */
+    virtual bool showOutput(bool success)
+    {
+        return true;
+    }
+
+    /*
+    Finishes up after the command ends.  The command's output has already been
+    printed.
+
+    Takes: bool (true if the command succeeded)
+    Returns: true if the job succeeded
+             false otherwise
+    */
+    virtual bool finish(bool success) = 0;
+
+    // Gets the name of what the job makes, for messages.
+    virtual std::string getName() = 0;
+
+    /*
+    Makes this job wait for the job that makes a file, if this build makes it.
+
+    Takes: string (file name)
+    */
+    void dependOn(const std::string& file);
+};
+
+
+/*
+Adds a job to the build.  The scheduler deletes it after runJobs().
+
+Takes: Job* (the new job)
+*/
+void addJob(Job* job);
+
+/*
+Remembers which job makes a file, so that jobs which use the file can depend
+on it.
+
+Takes: string (file name)
+       Job* (the job that makes it)
+*/
+void setProducer(const std::string& file, Job* job);
+
+/*
+Gets the job that makes a file.
+
+Takes: string (file name)
+Returns: Job* (the job, or NULL if the file is not made by this build)
+*/
+Job* getProducer(const std::string& file);
+
+/*
+Remembers another name that a job can be asked for by, like the output or
+source name given in the pilefile.
+
+Takes: string (name)
+       Job* (the job, or NULL if the file is already up to date)
+*/
+void addTargetName(const std::string& name, Job* job);
+
+/*
+Drops every job that is not needed to make the given targets.  A target is a
+file that a job makes or a name given with addTargetName().
+
+Takes: list<string> (target names)
+Returns: true if every target was found
+         false otherwise
+*/
+bool selectTargets(const std::list<std::string>& targets);
+
+/*
+Drops every job that is not needed to make the given files.  Files that no job
+makes are skipped.
+
+Takes: list<string> (file names)
+Returns: int (number of jobs left)
+*/
+int keepJobsFor(const std::list<std::string>& files);
+
+/*
+Drops the jobs that make any of the given files, since they were made some
+other way.  Jobs that need the files stop waiting for them.
+
+Takes: set<string> (file names)
+*/
+void dropJobsFor(const std::set<std::string>& files);
+
+/*
+Gets the number of commands that could still be started right now.  Tools which
+can use several threads use this to decide how many.
+
+Returns: int (free slots, at least 1)
+*/
+int getFreeJobSlots();
+
+/*
+Runs all of the jobs, up to the given number at a time, then deletes them.
+Jobs whose dependencies failed are skipped.  Each worker is one more slot for
+jobs that can run remotely; those only go to a worker when every local slot is
+busy, and the rest (like linking) always run here.
+
+Takes: int (number of commands to run at once here)
+       list<string> (pile-worker addresses, one per slot)
+Returns: true if every job succeeded
+         false otherwise
+*/
+bool runJobs(int slots, const std::list<std::string>& workers);
+
+/*
+Deletes all of the jobs without running them.
+*/
+void clearJobs();
+
+#endif
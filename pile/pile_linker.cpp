@@ -0,0 +1,220 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_linker.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the functions which find and choose a linker backend (like
+mold, lld, or gold) for the linker driver, and keep the history of link times
+used to choose one.
+*/
+
+#include "pile_global.h"
+#include "pile_linker.h"
+#include "pile_compiler.h"
+#include "pile_ui.h"
+#include "External Code/goodio.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// Only the last few links count toward a backend's average.
+#define PILE_LINK_HISTORY_SIZE 10
+
+// The time recorded for a backend that could not link an output at all
+#define PILE_FAILED_LINK_TIME 3600000UL
+
+// Another backend must be this much faster (as a fraction of the current
+// one's average) before an output switches to it, so that backends which are
+// about as fast don't take turns.
+#define PILE_LINK_SWITCH_MARGIN 0.1f
+
+string getLinkHistoryFile()
+{
+    return getConfigDir() + "link_history";
+}
+
+list<string> findLinkerBackends()
+{
+    static bool probed = false;
+    static list<string> backends;
+    if(probed)
+        return backends;
+    probed = true;
+
+    if(isInPath("ld.mold") || isInPath("mold"))
+        backends.push_back("mold");
+    if(isInPath("ld.lld"))
+        backends.push_back("lld");
+    if(isInPath("ld.gold"))
+        backends.push_back("gold");
+
+    for(list<string>::iterator e = backends.begin(); e != backends.end(); e++)
+        UI_debug_pile("Found linker backend: %s\n", e->c_str());
+    return backends;
+}
+
+bool usesLinkerBackends(const string& linker)
+{
+    return (getCompilerFamily(linker) != COMPILER_UNKNOWN);
+}
+
+/*
+Reads the link history for one output.
+
+Takes: string (output file name)
+       map<string, pair<int, unsigned long> > (number of links and total time
+                                               for each backend)
+       string (the backend that linked it last is stored here)
+*/
+void readLinkHistory(const string& outfile, map<string, pair<int, unsigned long> >& history, string& latest)
+{
+    ifstream fin(getLinkHistoryFile().c_str());
+    if(fin.fail())
+        return;
+
+    // Each line holds: backend count total_milliseconds output
+    // recordLinkTime() moves the line it updates to the end, so the last one
+    // for the output is the backend that linked it last.
+    string line;
+    while(getline(fin, line))
+    {
+        stringstream str(line);
+        string backend;
+        int count = 0;
+        unsigned long total = 0;
+        string out;
+        str >> backend >> count >> total;
+        getline(str, out);
+        if(out.size() > 0 && out[0] == ' ')
+            out.erase(0, 1);
+        if(out == outfile && count > 0)
+        {
+            history[backend] = make_pair(count, total);
+            latest = backend;
+        }
+    }
+}
+
+string chooseLinkerBackend(const string& requested, const string& outfile)
+{
+    if(requested != "auto" && requested != "")
+        return requested;
+
+    list<string> backends = findLinkerBackends();
+    backends.push_back("default");
+
+    map<string, pair<int, unsigned long> > history;
+    string current;
+    readLinkHistory(outfile, history, current);
+
+    string best;
+    float bestTime = 0.0f;
+    for(list<string>::iterator e = backends.begin(); e != backends.end(); e++)
+    {
+        map<string, pair<int, unsigned long> >::iterator h = history.find(*e);
+        if(h == history.end())
+        {
+            UI_debug_pile("Trying linker backend %s for %s\n", e->c_str(), outfile.c_str());
+            return *e;
+        }
+        float average = float(h->second.second) / h->second.first;
+        if(best == "" || average < bestTime)
+        {
+            best = *e;
+            bestTime = average;
+        }
+    }
+
+    // Stay with the backend in use unless the best one is clearly faster.
+    map<string, pair<int, unsigned long> >::iterator h = history.find(current);
+    if(h != history.end() && best != current && find(backends.begin(), backends.end(), current) != backends.end())
+    {
+        float currentTime = float(h->second.second) / h->second.first;
+        if(bestTime > currentTime * (1.0f - PILE_LINK_SWITCH_MARGIN))
+        {
+            UI_debug_pile("Keeping linker backend %s for %s (%.0f ms, %s: %.0f ms)\n", current.c_str(), outfile.c_str(), currentTime, best.c_str(), bestTime);
+            return current;
+        }
+    }
+    UI_debug_pile("Linker backend %s is fastest for %s (%.0f ms)\n", best.c_str(), outfile.c_str(), bestTime);
+    return best;
+}
+
+vector<string> linkerBackendOptions(const string& backend, int threads)
+{
+    vector<string> result;
+    if(backend == "" || backend == "default")
+        return result;
+
+    result.push_back("-fuse-ld=" + backend);
+
+    stringstream count;
+    count << threads;
+    if(backend == "mold")
+        result.push_back("-Wl,--thread-count=" + count.str());
+    else if(backend == "lld")
+        result.push_back("-Wl,--threads=" + count.str());
+    else if(backend == "gold" && threads > 1)
+        result.push_back("-Wl,--threads,--thread-count," + count.str());
+    return result;
+}
+
+void recordLinkTime(const string& backend, const string& outfile, unsigned long milliseconds)
+{
+    // Keep the other lines as they are.
+    string file = getLinkHistoryFile();
+    string others;
+    int count = 0;
+    unsigned long total = 0;
+
+    ifstream fin(file.c_str());
+    string line;
+    while(getline(fin, line))
+    {
+        stringstream str(line);
+        string b;
+        int c = 0;
+        unsigned long t = 0;
+        string out;
+        str >> b >> c >> t;
+        getline(str, out);
+        if(out.size() > 0 && out[0] == ' ')
+            out.erase(0, 1);
+        if(b == backend && out == outfile)
+        {
+            count = c;
+            total = t;
+        }
+        else if(line != "")
+            others += line + "\n";
+    }
+    fin.close();
+
+    // Drop an average link from the old ones so that recent links count more.
+    if(count >= PILE_LINK_HISTORY_SIZE)
+    {
+        total -= total / count;
+        count--;
+    }
+    count++;
+    total += milliseconds;
+
+    ofstream fout(file.c_str(), ios::trunc);
+    if(fout.fail())
+    {
+        UI_debug_pile("Could not write link history to %s\n", file.c_str());
+        return;
+    }
+    fout << others << backend << " " << count << " " << total << " " << outfile << endl;
+}
+
+void recordFailedLink(const string& backend, const string& outfile)
+{
+    recordLinkTime(backend, outfile, PILE_FAILED_LINK_TIME);
+}
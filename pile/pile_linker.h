@@ -0,0 +1,80 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_linker.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_linker.cpp
+*/
+
+#ifndef _PILE_LINKER_H__
+#define _PILE_LINKER_H__
+
+#include <list>
+#include <string>
+#include <vector>
+
+/*
+Finds the faster linker backends (mold, lld, gold) that are installed.  The
+driver's own linker, "default", is always available and is not listed.
+
+Returns: list<string> (backend names, fastest first)
+*/
+std::list<std::string> findLinkerBackends();
+
+/*
+Tells whether a linker driver (like gcc or clang) understands -fuse-ld.
+
+Takes: string (linker path)
+Returns: true if it does
+         false otherwise
+*/
+bool usesLinkerBackends(const std::string& linker);
+
+/*
+Chooses the linker backend for an output.  A backend other than "auto" is used
+as given.  With "auto", each installed backend is tried once for the output,
+then the one with the shortest average link time in the history is used.  The
+backend that linked it last is kept unless another is at least 10% faster.
+
+Takes: string (requested backend: "auto", "default", "mold", "lld", or "gold")
+       string (output file name)
+Returns: string (backend name)
+*/
+std::string chooseLinkerBackend(const std::string& requested, const std::string& outfile);
+
+/*
+Gets the linker options that select a backend and set how many threads it
+uses.
+
+Takes: string (backend name)
+       int (number of threads)
+Returns: vector<string> (options for the linker driver)
+*/
+std::vector<std::string> linkerBackendOptions(const std::string& backend, int threads);
+
+/*
+Adds a link time to the history (in the config directory), which
+chooseLinkerBackend() uses to pick a backend.
+
+Takes: string (backend name)
+       string (output file name)
+       unsigned long (link time in milliseconds)
+*/
+void recordLinkTime(const std::string& backend, const std::string& outfile, unsigned long milliseconds);
+
+/*
+Adds a failed link to the history, so that chooseLinkerBackend() stops
+choosing the backend for this output.
+
+Takes: string (backend name)
+       string (output file name)
+*/
+void recordFailedLink(const std::string& backend, const std::string& outfile);
+
+#endif
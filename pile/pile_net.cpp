@@ -0,0 +1,235 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_net.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the sockets that pile-worker and the build cache use.  Only
+the Linux build has them for now; elsewhere connecting simply fails, so builds
+go on without workers or a cache.
+*/
+
+#include "pile_global.h"
+#include "pile_net.h"
+#include "pile_ui.h"
+
+#ifdef PILE_LINUX
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+void Connection::close()
+{
+    #ifdef PILE_LINUX
+    if(fd >= 0)
+        ::close(fd);
+    #endif
+    fd = -1;
+    buffer.clear();
+}
+
+bool Connection::send(const string& data)
+{
+    #ifdef PILE_LINUX
+    unsigned long sent = 0;
+    while(fd >= 0 && sent < data.size())
+    {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0)
+            return false;
+        sent += n;
+    }
+    return (fd >= 0);
+    #else
+    return false;
+    #endif
+}
+
+// Reads more into the buffer.  Returns false when the connection has ended.
+bool receiveMore(int fd, string& buffer)
+{
+    #ifdef PILE_LINUX
+    if(fd < 0)
+        return false;
+    char buff[16384];
+    ssize_t n = recv(fd, buff, sizeof(buff), 0);
+    if(n <= 0)
+        return false;
+    buffer.append(buff, n);
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+bool Connection::readLine(string& line)
+{
+    string::size_type end;
+    while((end = buffer.find('\n')) == string::npos)
+    {
+        if(!receiveMore(fd, buffer))
+            return false;
+    }
+    line = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    if(line.size() > 0 && line[line.size()-1] == '\r')
+        line.erase(line.size()-1);
+    return true;
+}
+
+bool Connection::readBytes(unsigned long size, string& data)
+{
+    while(buffer.size() < size)
+    {
+        if(!receiveMore(fd, buffer))
+            return false;
+    }
+    data = buffer.substr(0, size);
+    buffer.erase(0, size);
+    return true;
+}
+
+void Connection::readAll(string& data)
+{
+    while(receiveMore(fd, buffer))
+    {}
+    data = buffer;
+    buffer.clear();
+}
+
+
+#ifdef PILE_LINUX
+// Splits "host:port" or "port".  The host defaults to this machine.
+bool splitAddress(const string& address, string& host, string& port)
+{
+    string::size_type colon = address.rfind(':');
+    if(colon == string::npos)
+    {
+        host = "127.0.0.1";
+        port = address;
+    }
+    else
+    {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+    return (host != "" && port != "");
+}
+
+// Opens a socket for an address, then connects or binds it.
+int openSocket(const string& address, bool listening)
+{
+    if(address.find('/') != string::npos)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(address.size() >= sizeof(addr.sun_path))
+            return -1;
+        strcpy(addr.sun_path, address.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0)
+            return -1;
+        if(listening)
+        {
+            unlink(address.c_str());
+            if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+            {
+                ::close(fd);
+                return -1;
+            }
+        }
+        else if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    string host;
+    string port;
+    if(!splitAddress(address, host, port))
+        return -1;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* info = NULL;
+    if(getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0)
+        return -1;
+
+    int fd = -1;
+    for(struct addrinfo* e = info; e != NULL && fd < 0; e = e->ai_next)
+    {
+        fd = socket(e->ai_family, e->ai_socktype, e->ai_protocol);
+        if(fd < 0)
+            continue;
+        int result;
+        if(listening)
+        {
+            int yes = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            result = bind(fd, e->ai_addr, e->ai_addrlen);
+        }
+        else
+            result = connect(fd, e->ai_addr, e->ai_addrlen);
+        if(result < 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(info);
+    return fd;
+}
+#endif
+
+bool connectTo(const string& address, Connection& conn)
+{
+    conn.close();
+    #ifdef PILE_LINUX
+    conn.fd = openSocket(address, false);
+    #endif
+    return conn.isOpen();
+}
+
+int listenOn(const string& address)
+{
+    #ifdef PILE_LINUX
+    int fd = openSocket(address, true);
+    if(fd < 0)
+        return -1;
+    if(listen(fd, 64) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+    #else
+    UI_error("pile error: Listening for connections is not supported here.\n");
+    return -1;
+    #endif
+}
+
+bool acceptConnection(int listener, Connection& conn)
+{
+    conn.close();
+    #ifdef PILE_LINUX
+    conn.fd = accept(listener, NULL, NULL);
+    #endif
+    return conn.isOpen();
+}
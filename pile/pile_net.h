@@ -0,0 +1,117 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_net.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_net.cpp, contains the Connection class definition.
+*/
+
+#ifndef _PILE_NET_H__
+#define _PILE_NET_H__
+
+#include <string>
+
+/*
+A connection to another process, over TCP or a unix socket.  Addresses are
+either "host:port" or the path of a unix socket (anything with a '/' in it).  A
+port alone means that port on this machine.
+*/
+class Connection
+{
+    private:
+    // Connections own their socket, so they are not copied.
+    Connection(const Connection& other);
+    Connection& operator=(const Connection& other);
+
+    public:
+    int fd;
+    std::string buffer;  // Received, but not read yet
+
+    Connection()
+        : fd(-1)
+    {}
+
+    ~Connection()
+    {
+        close();
+    }
+
+    bool isOpen()
+    {
+        return (fd >= 0);
+    }
+
+    void close();
+
+    /*
+    Sends all of the data.
+
+    Takes: string (data)
+    Returns: true on success
+             false if the connection failed
+    */
+    bool send(const std::string& data);
+
+    /*
+    Reads up to the next newline, which is dropped along with any '\r'.
+
+    Takes: string (the line is stored here)
+    Returns: true on success
+             false if the connection ended first
+    */
+    bool readLine(std::string& line);
+
+    /*
+    Reads an exact number of bytes.
+
+    Takes: unsigned long (number of bytes)
+           string (the data is stored here)
+    Returns: true on success
+             false if the connection ended first
+    */
+    bool readBytes(unsigned long size, std::string& data);
+
+    /*
+    Reads everything until the other side closes the connection.
+
+    Takes: string (the data is stored here)
+    */
+    void readAll(std::string& data);
+};
+
+/*
+Connects to an address.
+
+Takes: string (address)
+       Connection (the new connection)
+Returns: true on success
+         false on failure
+*/
+bool connectTo(const std::string& address, Connection& conn);
+
+/*
+Starts listening for connections at an address.  A unix socket that is left
+over from before is replaced.
+
+Takes: string (address)
+Returns: int (the listening socket, or -1 on failure)
+*/
+int listenOn(const std::string& address);
+
+/*
+Waits for the next connection to a listening socket.
+
+Takes: int (listening socket)
+       Connection (the new connection)
+Returns: true on success
+         false on failure
+*/
+bool acceptConnection(int listener, Connection& conn);
+
+#endif
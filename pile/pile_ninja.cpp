@@ -0,0 +1,203 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_ninja.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains 'pile --emit-ninja', which writes the build that the
+pilefile describes as a build.ninja, so that Ninja (or a tool that reads its
+files) can run it.  Each compile and link gets its own command, since the
+options can differ for every call to build() and link().
+*/
+
+#include "pile_global.h"
+#include "pile_ninja.h"
+#include "pile_ui.h"
+#include "pile_commands.h"
+#include "pile_system.h"
+#include "string_functions.h"
+#include <fstream>
+#include <set>
+
+// A compile or link that build.ninja does
+class NinjaEdge
+{
+    public:
+    string rule;
+    string output;
+    vector<string> inputs;
+    string command;
+    string source;  // For compiles, to find what it includes
+    string pch;  // For compiles, the precompiled header they wait for
+
+    NinjaEdge(const string& rule, const string& output, const vector<string>& inputs, const string& command)
+        : rule(rule)
+        , output(output)
+        , inputs(inputs)
+        , command(command)
+    {}
+};
+
+vector<NinjaEdge> ninjaEdges;
+set<string> ninjaOutputs;
+
+
+void recordNinjaCompile(const string& source, const string& object, const string& command, bool depfile, const string& pch)
+{
+    if(!ninjaOutputs.insert(object).second)
+        return;
+    NinjaEdge edge((depfile? "compile" : "compile_plain"), object, vector<string>(1, source), command);
+    edge.source = source;
+    edge.pch = pch;
+    ninjaEdges.push_back(edge);
+}
+
+void recordNinjaPrecompile(const string& header, const string& output, const string& command)
+{
+    if(!ninjaOutputs.insert(output).second)
+        return;
+    ninjaEdges.push_back(NinjaEdge("precompile", output, vector<string>(1, header), command));
+}
+
+void recordNinjaLink(const string& output, const vector<string>& inputs, const string& command)
+{
+    if(!ninjaOutputs.insert(output).second)
+        return;
+    ninjaEdges.push_back(NinjaEdge("link", output, inputs, command));
+}
+
+// Escapes a path for a build line.
+string ninjaPath(const string& path)
+{
+    string result;
+    for(unsigned int i = 0; i < path.size(); i++)
+    {
+        if(path[i] == '$' || path[i] == ' ' || path[i] == ':')
+            result += '$';
+        result += path[i];
+    }
+    return result;
+}
+
+// Escapes a variable's value.
+string ninjaValue(const string& value)
+{
+    string result;
+    for(unsigned int i = 0; i < value.size(); i++)
+    {
+        if(value[i] == '$')
+            result += '$';
+        result += value[i];
+    }
+    return result;
+}
+
+/*
+The depfile rule is for compilers like gcc, which list the headers that they
+read.  Other compilers get the headers that Pile found as implicit inputs,
+though new includes are only seen when build.ninja is written again.  Linking
+and archiving use restat, so nothing is linked again when an output comes out
+the same.
+*/
+bool writeNinja(const string& pilefile, const list<string>& buildFiles, const vector<string>& args, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    string root = ioGetCWD();
+    ofstream fout(PILE_NINJA_FILE, ios::trunc);
+    if(fout.fail())
+    {
+        UI_error("pile error: Could not write %s\n", PILE_NINJA_FILE);
+        return false;
+    }
+
+    string pilefileName = relativeToDir(root, absolutePath(pilefile));
+    fout << "# Written by 'pile --emit-ninja' from " << pilefileName << ".  Changes here are lost when it is written again." << endl;
+    fout << "ninja_required_version = 1.3" << endl << endl;
+
+    fout << "rule compile" << endl;
+    fout << "  command = $cmd -MMD -MF $out.d" << endl;
+    fout << "  description = Compiling $in" << endl;
+    fout << "  depfile = $out.d" << endl;
+    fout << "  deps = gcc" << endl << endl;
+
+    fout << "rule compile_plain" << endl;
+    fout << "  command = $cmd" << endl;
+    fout << "  description = Compiling $in" << endl << endl;
+
+    fout << "rule precompile" << endl;
+    fout << "  command = $cmd -MMD -MF $out.d" << endl;
+    fout << "  description = Precompiling $in" << endl;
+    fout << "  depfile = $out.d" << endl;
+    fout << "  deps = gcc" << endl << endl;
+
+    fout << "rule link" << endl;
+    fout << "  command = $cmd" << endl;
+    fout << "  description = Linking $out" << endl;
+    fout << "  restat = 1" << endl << endl;
+
+    fout << "rule regen" << endl;
+    fout << "  command = $cmd" << endl;
+    fout << "  description = Reading " << ninjaValue(pilefileName) << endl;
+    fout << "  generator = 1" << endl << endl;
+
+    // The pilefile is read again when it or anything it read changes.
+    vector<string> regenArgs;
+    regenArgs.push_back(quoteWhitespace(getExecutablePath()));
+    for(vector<string>::const_iterator e = args.begin(); e != args.end(); e++)
+        regenArgs.push_back(quoteWhitespace(*e));
+    set<string> written;
+    fout << "build " << PILE_NINJA_FILE << ": regen";
+    for(list<string>::const_iterator e = buildFiles.begin(); e != buildFiles.end(); e++)
+    {
+        if(ioExists(*e) && written.insert(absolutePath(*e)).second)
+            fout << " " << ninjaPath(relativeToDir(root, absolutePath(*e)));
+    }
+    fout << endl;
+    fout << "  cmd = " << ninjaValue(joinArgs(regenArgs)) << endl << endl;
+
+    for(vector<NinjaEdge>::iterator e = ninjaEdges.begin(); e != ninjaEdges.end(); e++)
+    {
+        fout << "build " << ninjaPath(relativeToDir(root, absolutePath(e->output))) << ": " << e->rule;
+        for(vector<string>::iterator f = e->inputs.begin(); f != e->inputs.end(); f++)
+            fout << " " << ninjaPath(relativeToDir(root, absolutePath(*f)));
+
+        bool first = true;
+        if(e->pch != "")
+        {
+            fout << " | " << ninjaPath(relativeToDir(root, absolutePath(e->pch)));
+            first = false;
+        }
+        if(e->rule == "compile_plain")
+        {
+            map<string, FileData*>::iterator fd = fileDataHash.find(e->source);
+            if(fd != fileDataHash.end() && fd->second != NULL)
+            {
+                set<FileData*> includes;
+                collectDepends(depends, fd->second, includes);
+                for(set<FileData*>::iterator f = includes.begin(); f != includes.end(); f++)
+                {
+                    // Headers that could not be found are system headers.
+                    if(!(*f)->exists())
+                        continue;
+                    fout << (first? " | " : " ") << ninjaPath(relativeToDir(root, absolutePath((*f)->getPath())));
+                    first = false;
+                }
+            }
+        }
+        fout << endl;
+        fout << "  cmd = " << ninjaValue(e->command) << endl;
+    }
+
+    fout.close();
+    if(fout.fail())
+    {
+        UI_error("pile error: Could not write %s\n", PILE_NINJA_FILE);
+        return false;
+    }
+    UI_print("Wrote %s with %d commands.\n", PILE_NINJA_FILE, int(ninjaEdges.size()));
+    return true;
+}
@@ -0,0 +1,75 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_ninja.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_ninja.cpp
+*/
+
+#ifndef _PILE_NINJA_H__
+#define _PILE_NINJA_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "pile_depend.h"
+
+// What 'pile --emit-ninja' writes, beside the pilefile
+#define PILE_NINJA_FILE "build.ninja"
+
+/*
+Remembers how a source is compiled, for build.ninja.  An object that is already
+recorded (like from an earlier build() call) is skipped.
+
+Takes: string (source file name)
+       string (object file name)
+       string (the command, from compileCommand())
+       bool (true if the compiler can write a depfile, like gcc and clang can)
+       string (the precompiled header that the command uses, or "")
+*/
+void recordNinjaCompile(const std::string& source, const std::string& object, const std::string& command, bool depfile, const std::string& pch);
+
+/*
+Remembers how a precompiled header is made, for build.ninja.  The compiles
+that use it wait for it.
+
+Takes: string (generated header)
+       string (precompiled header)
+       string (the command)
+*/
+void recordNinjaPrecompile(const std::string& header, const std::string& output, const std::string& command);
+
+/*
+Remembers how an output (a program or a library) is linked or archived, for
+build.ninja.
+
+Takes: string (output file name)
+       vector<string> (objects and libraries that go into it)
+       string (the command)
+*/
+void recordNinjaLink(const std::string& output, const std::vector<std::string>& inputs, const std::string& command);
+
+/*
+Writes build.ninja from what was recorded.  It builds the same outputs that
+Pile would, and it runs Pile again to write itself over when a pilefile
+changes.
+
+Takes: string (pilefile name)
+       list<string> (every file that was read to get the build, like the
+                     pilefile, the files it included, and pile.conf)
+       vector<string> (arguments which make Pile write it again)
+       map<FileData*, list<FileData*> > (dependencies)
+       map<string, FileData*> (file data)
+Returns: true on success
+         false on failure
+*/
+bool writeNinja(const std::string& pilefile, const std::list<std::string>& buildFiles, const std::vector<std::string>& args, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+#endif
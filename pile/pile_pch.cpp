@@ -0,0 +1,333 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_pch.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the functions which choose, generate, and precompile a
+shared header for the sources in one compile() call.
+*/
+
+#include "pile_global.h"
+#include "pile_config.h"
+#include "pile_pch.h"
+#include "pile_commands.h"
+#include "pile_compiler.h"
+#include "pile_jobs.h"
+#include "pile_ninja.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+string getExtension(const string& file);
+
+
+// Gets the headers that a source includes itself, in order.  Headers that come
+// through another source (like the members of a unity file) count too.
+void topHeaders(map<FileData*, list<FileData*> >& depends, FileData* file, vector<FileData*>& result, set<FileData*>& visited)
+{
+    if(!visited.insert(file).second)
+        return;
+    map<FileData*, list<FileData*> >::iterator d = depends.find(file);
+    if(d == depends.end())
+        return;
+    for(list<FileData*>::iterator e = d->second.begin(); e != d->second.end(); e++)
+    {
+        if(isSourceFile((*e)->getPath()))
+            topHeaders(depends, *e, result, visited);
+        else if(find(result.begin(), result.end(), *e) == result.end())
+            result.push_back(*e);
+    }
+}
+
+// Tells whether a header has an include guard or #pragma once, so that it does
+// no harm when a source includes it after the precompiled header did.  Comments
+// before it, like a license, are skipped.
+bool hasIncludeGuard(const string& file)
+{
+    ifstream fin(file.c_str());
+    if(fin.fail())
+        return false;
+
+    string line;
+    bool inComment = false;
+    while(getline(fin, line))
+    {
+        string::size_type pos = 0;
+        while(pos < line.size())
+        {
+            if(inComment)
+            {
+                string::size_type end = line.find("*/", pos);
+                if(end == string::npos)
+                    break;
+                pos = end + 2;
+                inComment = false;
+                continue;
+            }
+            if(line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r')
+            {
+                pos++;
+                continue;
+            }
+            if(line.compare(pos, 2, "//") == 0)
+                break;
+            if(line.compare(pos, 2, "/*") == 0)
+            {
+                pos += 2;
+                inComment = true;
+                continue;
+            }
+            if(line.compare(pos, 12, "#pragma once") == 0)
+                return true;
+            return (line.compare(pos, 7, "#ifndef") == 0 || line.compare(pos, 8, "#if !def") == 0);
+        }
+    }
+    return false;
+}
+
+// Tells whether a header may go into the precompiled header.  Headers which
+// Pile could not find are system headers.  Project headers must be guarded
+// and must not have changed in the last stableAge seconds, or every edit would
+// rebuild everything.
+bool isStableHeader(FileData* header, int stableAge)
+{
+    if(!header->exists())
+        return true;
+    if(stableAge > 0 && header->getDependTime() > time(NULL) - stableAge)
+        return false;
+    return hasIncludeGuard(header->getPath());
+}
+
+// Precompiles the generated header, unless it is up to date.  It runs before
+// the compiles that use it.
+class PrecompileJob : public Job
+{
+    public:
+    string command;
+    string header;
+    string output;
+    string fingerprintFile;
+    string fingerprint;
+    bool clang;
+
+    PrecompileJob(const string& command, const string& header, const string& output, const string& fingerprintFile, const string& fingerprint, bool clang)
+        : command(command)
+        , header(header)
+        , output(output)
+        , fingerprintFile(fingerprintFile)
+        , fingerprint(fingerprint)
+        , clang(clang)
+    {}
+
+    string start()
+    {
+        ioDelete(fingerprintFile.c_str());
+        UI_print(" Precompiling %s\n  %s\n", header.c_str(), command.c_str());
+        return command;
+    }
+
+    bool finish(bool success)
+    {
+        if(success && ioExists(output))
+        {
+            ofstream fout(fingerprintFile.c_str(), ios::trunc);
+            fout << fingerprint;
+            return true;
+        }
+        ioDelete(output.c_str());
+        // gcc reads the header itself when there is no .gch, but clang needs
+        // the .pch.
+        if(clang)
+        {
+            UI_error("Could not precompile %s.\n", header.c_str());
+            return false;
+        }
+        UI_warning("Warning: Could not precompile %s.  Building without it.\n", header.c_str());
+        return true;
+    }
+
+    string getName()
+    {
+        return output;
+    }
+};
+
+/*
+Picks the precompiled header for one language and adds a job that builds it.
+
+Takes: string (compiler path)
+       string (compiler options)
+       vector<string> (source file names)
+       string (directory for the precompiled headers)
+       string (".c" or ".cpp")
+       map<FileData*, list<FileData*> > (dependencies)
+       map<string, FileData*> (file data)
+       int (seconds that a project header must have gone unchanged to be used)
+       map<string, string> (extra options are added here)
+       map<string, string> (the precompiled header each source needs is
+                            added here)
+*/
+void makePrecompiledHeader(const string& compiler, const string& options, const vector<string>& sources, const string& pchDir, const string& ext, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash, int stableAge, map<string, string>& result, map<string, string>& pchFiles)
+{
+    if(sources.size() < 2)
+        return;
+
+    // Find the headers that each source includes.
+    vector<vector<FileData*> > includes(sources.size());
+    map<FileData*, int> fanIn;
+    vector<FileData*> order;
+    for(unsigned int i = 0; i < sources.size(); i++)
+    {
+        map<string, FileData*>::iterator fd = fileDataHash.find(sources[i]);
+        if(fd == fileDataHash.end() || fd->second == NULL)
+            continue;
+        set<FileData*> visited;
+        topHeaders(depends, fd->second, includes[i], visited);
+        for(vector<FileData*>::iterator h = includes[i].begin(); h != includes[i].end(); h++)
+        {
+            if(fanIn[*h]++ == 0)
+                order.push_back(*h);
+        }
+    }
+
+    // Take the most shared headers first, as long as enough sources still
+    // include all of the chosen ones.
+    vector<pair<int, FileData*> > candidates;
+    for(vector<FileData*>::iterator h = order.begin(); h != order.end(); h++)
+    {
+        if(fanIn[*h] >= PILE_PCH_MIN_SHARE * sources.size() && isStableHeader(*h, stableAge))
+            candidates.push_back(make_pair(-fanIn[*h], *h));
+    }
+    stable_sort(candidates.begin(), candidates.end());
+
+    set<FileData*> chosen;
+    vector<bool> users(sources.size(), true);
+    for(vector<pair<int, FileData*> >::iterator c = candidates.begin(); c != candidates.end(); c++)
+    {
+        vector<bool> next(sources.size(), false);
+        unsigned int count = 0;
+        for(unsigned int i = 0; i < sources.size(); i++)
+        {
+            next[i] = users[i] && find(includes[i].begin(), includes[i].end(), c->second) != includes[i].end();
+            if(next[i])
+                count++;
+        }
+        if(count < 2 || count < PILE_PCH_MIN_SHARE * sources.size())
+            continue;
+        chosen.insert(c->second);
+        users = next;
+    }
+
+    if(chosen.size() == 0)
+        return;
+
+    // Write the header with the chosen headers in the order they are first
+    // included.  Each set of headers and options gets its own directory, so
+    // that the compile() calls of a variant do not write over each other's.
+    // Paths in the project are relative, so that every checkout names it the
+    // same and their compiles share the cache.
+    vector<FileData*> headers;
+    string headerSet = compiler + "\n" + mapPathPrefix(ioGetCWD(), options) + "\n";
+    for(vector<FileData*>::iterator h = order.begin(); h != order.end(); h++)
+    {
+        if(chosen.find(*h) == chosen.end())
+            continue;
+        headers.push_back(*h);
+        headerSet += ((*h)->exists()? relativeToDir(ioGetCWD(), absolutePath((*h)->getPath())) : (*h)->getPath()) + "\n";
+    }
+    string dir = addDirSlash(pchDir) + hashToString(hashString(headerSet));
+    mkpath(dir);
+
+    string header = addDirSlash(dir) + "pile_pch" + (ext == ".c"? ".h" : ".hpp");
+    string text = "// Generated by pile.  Do not edit.\n";
+    string times;
+    for(vector<FileData*>::iterator h = headers.begin(); h != headers.end(); h++)
+    {
+        if((*h)->exists())
+        {
+            text += "#include \"" + pathFromDir(dir, (*h)->getPath()) + "\"\n";
+            stringstream time;
+            time << (*h)->getDependTime();
+            times += time.str() + "\n";
+        }
+        else
+            text += "#include <" + (*h)->getPath() + ">\n";
+    }
+    writeIfChanged(header, text);
+
+    bool clang = (getCompilerFamily(removeQuotes(compiler)) == COMPILER_CLANG);
+    string output = header + (clang? ".pch" : ".gch");
+    string fingerprintFile = header + ".fingerprint";
+    string fingerprint = hashToString(hashString(headerSet + times + text));
+
+    string buff = compiler + " " + options + (ext == ".c"? " -x c-header " : " -x c++-header ") + quoteWhitespace(header) + " -o " + quoteWhitespace(output);
+    convertSlashes(buff);
+    recordNinjaPrecompile(header, output, buff);
+
+    // The sources which use the precompiled header must be rebuilt whenever it
+    // is.
+    time_t pchTime;
+    if(!ioExists(output) || readFile(fingerprintFile) != fingerprint)
+    {
+        pchTime = time(NULL);
+        if(getProducer(output) == NULL)
+        {
+            Job* job = new PrecompileJob(buff, header, output, fingerprintFile, fingerprint, clang);
+            addJob(job);
+            setProducer(output, job);
+        }
+    }
+    else
+    {
+        // The compiles that use it wait for it, so an object from the same
+        // second is newer.
+        pchTime = ioTimeModified(output) - 1;
+    }
+
+    // The header is named relative to the project, so that the command (and
+    // its cache key) is the same in every checkout.
+    string projectHeader = relativeToDir(ioGetCWD(), absolutePath(header));
+    string extra = (clang? "-include-pch " + quoteWhitespace(projectHeader + ".pch") : "-include " + quoteWhitespace(projectHeader));
+    for(unsigned int i = 0; i < sources.size(); i++)
+    {
+        if(!users[i])
+            continue;
+        result[sources[i]] = extra;
+        pchFiles[sources[i]] = output;
+        FileData* fd = fileDataHash[sources[i]];
+        if(fd != NULL && fd->getDependTime() < pchTime)
+            fd->setDependTime(pchTime);
+    }
+}
+
+map<string, string> makePrecompiledHeaders(const string& compiler, const string& options, const list<string>& sources, const string& objPath, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash, int stableAge, map<string, string>& pchFiles)
+{
+    map<string, string> result;
+
+    vector<string> cSources;
+    vector<string> cppSources;
+    for(list<string>::const_iterator e = sources.begin(); e != sources.end(); e++)
+    {
+        string ext = getExtension(*e);
+        if(isCExt(ext))
+            cSources.push_back(*e);
+        else if(isCPPExt(ext))
+            cppSources.push_back(*e);
+    }
+
+    string pchDir = addDirSlash(objPath) + "pch";
+    makePrecompiledHeader(compiler, options, cSources, pchDir, ".c", depends, fileDataHash, stableAge, result, pchFiles);
+    makePrecompiledHeader(compiler, options, cppSources, pchDir, ".cpp", depends, fileDataHash, stableAge, result, pchFiles);
+
+    return result;
+}
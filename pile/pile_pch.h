@@ -0,0 +1,56 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_pch.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_pch.cpp
+*/
+
+#ifndef _PILE_PCH_H__
+#define _PILE_PCH_H__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "pile_depend.h"
+
+// Project headers which changed more recently than this (in seconds) are
+// left out of the precompiled header.  This is the default for cpp_compiler's
+// pch_stable_age.
+#define PILE_PCH_STABLE_AGE 3600
+
+// A header goes into the precompiled header only if at least this fraction of
+// the sources include it.
+#define PILE_PCH_MIN_SHARE 0.5f
+
+/*
+Picks the headers that most of the given sources include, writes them into a
+generated header, and adds a job that precompiles it (.gch for gcc, .pch for
+clang).  Each set of headers and options gets its own directory under
+<object path>/pch/.  The precompiled header is only rebuilt when its
+fingerprint (compiler, options, headers, and their times) changes.  Sources
+that include every chosen header have their dependency time updated so that
+they are rebuilt along with it, and their jobs should depend on it.
+
+Takes: string (compiler path)
+       string (compiler options)
+       list<string> (source file names)
+       string (object path, where the precompiled headers go)
+       map<FileData*, list<FileData*> > (dependencies)
+       map<string, FileData*> (file data)
+       int (seconds that a project header must have gone unchanged to be used)
+       map<string, string> (the precompiled header that each of those sources
+                            needs is stored here)
+Returns: map<string, string> (extra compiler options for each source that can
+         use a precompiled header)
+*/
+std::map<std::string, std::string> makePrecompiledHeaders(const std::string& compiler, const std::string& options, const std::list<std::string>& sources, const std::string& objPath, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash, int stableAge, std::map<std::string, std::string>& pchFiles);
+
+#endif
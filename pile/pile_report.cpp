@@ -0,0 +1,140 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_report.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains 'pile report', which looks through what earlier builds
+saved (the include graph, the compile times, and git's log) to show where the
+build time goes.
+*/
+
+#include "pile_global.h"
+#include "pile_report.h"
+#include "pile_git.h"
+#include "pile_graph.h"
+#include "pile_shard.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <set>
+
+// What including a header costs
+struct HeaderCost
+{
+    string name;
+    int sources;
+    unsigned long milliseconds;  // Compile time of the sources that include it
+    int commits;  // Commits that changed it lately
+    unsigned long long cost;  // What it is sorted by
+
+    HeaderCost()
+        : sources(0), milliseconds(0), commits(0), cost(0)
+    {}
+};
+
+bool sortByCost(const HeaderCost& a, const HeaderCost& b)
+{
+    if(a.cost != b.cost)
+        return a.cost > b.cost;
+    if(a.sources != b.sources)
+        return a.sources > b.sources;
+    return a.name < b.name;
+}
+
+bool printHeaderReport(int count)
+{
+    vector<pair<string, string> > sources;
+    map<string, vector<string> > includes;
+    if(!readGraphSources(sources, includes) || sources.size() == 0)
+    {
+        UI_error("pile error: There is no saved graph here yet.  Build once first.\n");
+        return false;
+    }
+    if(count < 1)
+        count = 1;
+
+    map<string, unsigned long> times;
+    readCompileTimes(times);
+    // The times are kept by object the way the pilefile named it.
+    map<string, unsigned long> objectTimes;
+    for(map<string, unsigned long>::iterator e = times.begin(); e != times.end(); e++)
+        objectTimes[absolutePath(e->first)] = e->second;
+
+    // Each source counts once per header, even when it is built more than once.
+    map<string, HeaderCost> headers;
+    map<string, set<string> > counted;
+    unsigned long timed = 0;
+    for(vector<pair<string, string> >::iterator e = sources.begin(); e != sources.end(); e++)
+    {
+        map<string, unsigned long>::iterator t = objectTimes.find(absolutePath(e->second));
+        unsigned long ms = (t == objectTimes.end()? 0 : t->second);
+        if(t != objectTimes.end())
+            timed++;
+
+        vector<string>& inc = includes[e->second];
+        for(vector<string>::iterator f = inc.begin(); f != inc.end(); f++)
+        {
+            if(isSourceFile(*f))
+                continue;
+            HeaderCost& h = headers[*f];
+            h.name = *f;
+            h.milliseconds += ms;
+            if(counted[*f].insert(e->first).second)
+                h.sources++;
+        }
+    }
+    if(headers.size() == 0)
+    {
+        UI_print("No headers are included by the sources in the graph.\n");
+        return true;
+    }
+
+    map<string, int> commits;
+    bool churn = getGitChurn(PILE_CHURN_DAYS, commits);
+    vector<HeaderCost> report;
+    for(map<string, HeaderCost>::iterator e = headers.begin(); e != headers.end(); e++)
+    {
+        HeaderCost& h = e->second;
+        if(churn)
+        {
+            map<string, int>::iterator c = commits.find(absolutePath(h.name));
+            h.commits = (c == commits.end()? 0 : c->second);
+            // Headers that did not change are still ranked by compile time.
+            h.cost = (unsigned long long)h.milliseconds * (h.commits + 1);
+        }
+        else
+            h.cost = h.milliseconds;
+        report.push_back(h);
+    }
+    sort(report.begin(), report.end(), sortByCost);
+
+    if(timed == 0)
+        UI_print("There are no compile times saved yet, so only the sources are counted.\n\n");
+    if(churn)
+    {
+        UI_print("Headers by compile time of their sources and commits in the last %d days:\n", PILE_CHURN_DAYS);
+        UI_print(" sources  compile time  commits  header\n");
+    }
+    else
+    {
+        UI_print("Headers by compile time of their sources (git's history was not found):\n");
+        UI_print(" sources  compile time  header\n");
+    }
+    for(unsigned int i = 0; i < report.size() && i < (unsigned int)count; i++)
+    {
+        const HeaderCost& h = report[i];
+        if(churn)
+            UI_print(" %7d  %9lu ms  %7d  %s\n", h.sources, h.milliseconds, h.commits, h.name.c_str());
+        else
+            UI_print(" %7d  %9lu ms  %s\n", h.sources, h.milliseconds, h.name.c_str());
+    }
+    if(report.size() > (unsigned int)count)
+        UI_print("(%d more)\n", int(report.size() - count));
+    return true;
+}
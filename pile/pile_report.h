@@ -0,0 +1,34 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_report.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_report.cpp
+*/
+
+#ifndef _PILE_REPORT_H__
+#define _PILE_REPORT_H__
+
+// How far back git is asked about changes to headers, in days
+#define PILE_CHURN_DAYS 90
+
+/*
+Prints the headers that cost the most compile time, for 'pile report headers'.
+For each header, it shows how many sources include it, how long those sources
+took to compile all together, and how many commits changed it lately (when
+this is a git checkout).  Headers that are both expensive and often changed
+come first.  It only uses what the last build saved, so nothing is built.
+
+Takes: int (number of headers to list)
+Returns: true on success
+         false if there is no saved graph
+*/
+bool printHeaderReport(int count);
+
+#endif
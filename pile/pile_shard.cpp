@@ -0,0 +1,277 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_shard.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the functions which split the compiling between several
+machines (--shard) and put their objects back together (merge-shards), and the
+compile times that they split the objects by.  The history, the header report,
+and the shards all use the same times.
+
+Each line of the compile times holds an object's last few times, newest
+first, and then the object:
+ <milliseconds>,<milliseconds>,... <object>
+*/
+
+#include "pile_global.h"
+#include "pile_shard.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_graph.h"
+#include "pile_history.h"
+#include "pile_jobs.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+map<string, unsigned long> compileTimes;  // Milliseconds, by object
+set<string> timedAlone;  // Objects that were compiled by themselves here
+
+
+void recordCompileTime(const string& object, unsigned long milliseconds, bool alone)
+{
+    compileTimes[object] = milliseconds;
+    if(alone)
+        timedAlone.insert(object);
+    else
+        timedAlone.erase(object);
+}
+
+// Reads the last few times of each object, newest first.
+bool readCompileTimeList(map<string, vector<unsigned long> >& times, const string& file)
+{
+    ifstream fin(file.c_str());
+    if(fin.fail())
+        return false;
+
+    string line;
+    while(getline(fin, line))
+    {
+        string::size_type space = line.find(' ');
+        if(space == string::npos)
+            continue;
+        string object = line.substr(space + 1);
+        if(times.find(object) != times.end())
+            continue;
+        vector<unsigned long>& t = times[object];
+        list<string> parts = ioExplode(line.substr(0, space), ',');
+        for(list<string>::iterator e = parts.begin(); e != parts.end(); e++)
+            t.push_back(atol(e->c_str()));
+    }
+    return true;
+}
+
+// Gets the middle of some times.
+unsigned long usualTime(vector<unsigned long> times)
+{
+    if(times.size() == 0)
+        return 0;
+    sort(times.begin(), times.end());
+    return times[times.size()/2];
+}
+
+bool readCompileTimes(map<string, unsigned long>& times, const string& file)
+{
+    map<string, vector<unsigned long> > all;
+    if(!readCompileTimeList(all, file))
+        return false;
+    for(map<string, vector<unsigned long> >::iterator e = all.begin(); e != all.end(); e++)
+    {
+        if(times.find(e->first) == times.end() && e->second.size() > 0)
+            times[e->first] = usualTime(e->second);
+    }
+    return true;
+}
+
+bool saveCompileTimes()
+{
+    if(compileTimes.size() == 0)
+        return true;
+
+    map<string, vector<unsigned long> > times;
+    readCompileTimeList(times, PILE_COMPILE_TIMES_FILE);
+    for(map<string, unsigned long>::iterator e = compileTimes.begin(); e != compileTimes.end(); e++)
+    {
+        vector<unsigned long>& t = times[e->first];
+        // Compare with the builds before this one.
+        if(timedAlone.find(e->first) != timedAlone.end() && t.size() >= 2)
+        {
+            unsigned long usual = usualTime(t);
+            if(e->second >= PILE_HISTORY_MIN_MS && e->second * 100 > usual * (100 + PILE_HISTORY_SLOWER_PERCENT))
+                UI_warning("pile Warning: %s took %lu ms to compile, but it has been taking about %lu ms.\n", e->first.c_str(), e->second, usual);
+        }
+        t.insert(t.begin(), e->second);
+        if(t.size() > PILE_HISTORY_BASELINE)
+            t.resize(PILE_HISTORY_BASELINE);
+    }
+
+    stringstream str;
+    for(map<string, vector<unsigned long> >::iterator e = times.begin(); e != times.end(); e++)
+    {
+        if(e->second.size() == 0)
+            continue;
+        for(unsigned int i = 0; i < e->second.size(); i++)
+            str << (i > 0? "," : "") << e->second[i];
+        str << " " << e->first << endl;
+    }
+
+    mkpath(PILE_PROJECT_DIR);
+    writeIfChanged(PILE_COMPILE_TIMES_FILE, str.str());
+    return true;
+}
+
+// Longest first, then by name so that every shard sorts the same way.
+bool longerCompile(const pair<unsigned long, string>& a, const pair<unsigned long, string>& b)
+{
+    if(a.first != b.first)
+        return (a.first > b.first);
+    return (a.second < b.second);
+}
+
+bool selectShard(int index, int count, const string& timesFile)
+{
+    if(count < 1 || index < 1 || index > count)
+    {
+        UI_error("pile error: There is no shard %d of %d.\n", index, count);
+        return false;
+    }
+
+    // Times that only this machine has would split the objects differently
+    // from the other shards.
+    map<string, unsigned long> times;
+    if(timesFile == "")
+        UI_print(" No --shard-times given, so every object counts the same.\n");
+    else if(!readCompileTimes(times, timesFile))
+        UI_warning("pile Warning: Could not read %s, so every object counts the same.\n", timesFile.c_str());
+
+    // Objects that have never been timed are guessed to take the average time.
+    unsigned long guess = 1;
+    if(times.size() > 0)
+    {
+        unsigned long total = 0;
+        for(map<string, unsigned long>::iterator e = times.begin(); e != times.end(); e++)
+            total += e->second;
+        guess = total / times.size();
+        if(guess < 1)
+            guess = 1;
+    }
+
+    // Every object counts, even if it is up to date here, so that each
+    // shard splits the same list.
+    vector<pair<unsigned long, string> > objects;
+    set<string> seen;
+    const vector<pair<string, string> >& compiles = getRecordedCompiles();
+    for(vector<pair<string, string> >::const_iterator e = compiles.begin(); e != compiles.end(); e++)
+    {
+        if(!seen.insert(e->second).second)
+            continue;
+        map<string, unsigned long>::iterator t = times.find(e->second);
+        objects.push_back(make_pair(t == times.end()? guess : t->second, e->second));
+    }
+    sort(objects.begin(), objects.end(), longerCompile);
+
+    vector<unsigned long> loads(count, 0);
+    list<string> mine;
+    unsigned long myLoad = 0;
+    for(vector<pair<unsigned long, string> >::iterator e = objects.begin(); e != objects.end(); e++)
+    {
+        int least = 0;
+        for(int i = 1; i < count; i++)
+        {
+            if(loads[i] < loads[least])
+                least = i;
+        }
+        loads[least] += e->first;
+        if(least == index - 1)
+        {
+            mine.push_back(e->second);
+            myLoad += e->first;
+        }
+    }
+
+    if(times.size() > 0)
+        UI_print(" Shard %d of %d: %d of %d objects (about %lu ms of compiling)\n", index, count, int(mine.size()), int(objects.size()), myLoad);
+    else
+        UI_print(" Shard %d of %d: %d of %d objects\n", index, count, int(mine.size()), int(objects.size()));
+
+    stringstream str;
+    for(list<string>::iterator e = mine.begin(); e != mine.end(); e++)
+        str << "object " << *e << endl;
+    mkpath(PILE_PROJECT_DIR);
+    writeIfChanged(PILE_SHARD_FILE, str.str());
+
+    if(keepJobsFor(mine) == 0)
+        UI_print(" Everything in this shard is up to date.\n");
+    return true;
+}
+
+bool copyShardObjects(const list<string>& dirs, set<string>& copied)
+{
+    bool result = true;
+    for(list<string>::const_iterator d = dirs.begin(); d != dirs.end(); d++)
+    {
+        string dir = addDirSlash(*d);
+        ifstream fin((dir + PILE_SHARD_FILE).c_str());
+        if(fin.fail())
+        {
+            UI_error("pile error: %s was not built as a shard.\n", d->c_str());
+            result = false;
+            continue;
+        }
+
+        map<string, unsigned long> times;
+        readCompileTimes(times, dir + PILE_COMPILE_TIMES_FILE);
+
+        int count = 0;
+        string line;
+        while(getline(fin, line))
+        {
+            if(line.substr(0, 7) != "object ")
+                continue;
+            string object = line.substr(7);
+            mkpath(ioStripToDir(object));
+            if(!ioCopy(dir + object, object))
+            {
+                UI_error("pile error: Could not copy %s from %s.\n", object.c_str(), d->c_str());
+                result = false;
+                continue;
+            }
+            copied.insert(object);
+            map<string, unsigned long>::iterator t = times.find(object);
+            if(t != times.end())
+                recordCompileTime(object, t->second);
+            count++;
+        }
+        UI_print(" Copied %d objects from %s\n", count, d->c_str());
+    }
+    return result;
+}
+
+bool checkShardsMerged(const set<string>& copied)
+{
+    // The shards' lists say what was built.  The copies can look no newer
+    // than their sources, since file times only count whole seconds.
+    bool result = true;
+    set<string> seen;
+    const vector<pair<string, string> >& compiles = getRecordedCompiles();
+    for(vector<pair<string, string> >::const_iterator e = compiles.begin(); e != compiles.end(); e++)
+    {
+        if(seen.insert(e->second).second && copied.find(e->second) == copied.end())
+        {
+            UI_error("pile error: No shard built %s.\n", e->second.c_str());
+            result = false;
+        }
+    }
+    if(result)
+        dropJobsFor(copied);
+    return result;
+}
@@ -0,0 +1,100 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_shard.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_shard.cpp
+*/
+
+#ifndef _PILE_SHARD_H__
+#define _PILE_SHARD_H__
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+// How long each object took to compile the last few times, for balancing the
+// shards, 'pile history', 'pile report headers', and noticing slow compiles
+#define PILE_COMPILE_TIMES_FILE ".pile/compile_times"
+
+// The objects that a shard built, for 'pile merge-shards'
+#define PILE_SHARD_FILE ".pile/shard"
+
+/*
+Remembers how long an object took to compile.
+
+Takes: string (object file name)
+       unsigned long (milliseconds)
+       bool (true if it was compiled by itself here, so that the time can be
+             compared with how long it usually takes)
+*/
+void recordCompileTime(const std::string& object, unsigned long milliseconds, bool alone = false);
+
+/*
+Reads saved compile times, which are the middle of the last few times of each
+object.  Times already in the map are kept.
+
+Takes: map<string, unsigned long> (milliseconds, by object, are stored here)
+       string (file to read, PILE_COMPILE_TIMES_FILE by default)
+Returns: true if the file was read
+         false otherwise
+*/
+bool readCompileTimes(std::map<std::string, unsigned long>& times, const std::string& file = PILE_COMPILE_TIMES_FILE);
+
+/*
+Saves the compile times recorded during this build along with the older ones,
+keeping the last PILE_HISTORY_BASELINE times of each object.  An object that
+took much longer to compile than it has lately gets a warning.
+
+Returns: true on success
+         false on failure
+*/
+bool saveCompileTimes();
+
+/*
+Splits the objects of the build into shards that should take about the same
+time to compile and drops every job that shard 'index' does not need.  The
+longest compiles are handed out first, each to the shard with the least work
+so far.  Every shard has to see the same pilefile and compile times to agree on
+the split, so the times come from a file that is given to all of them (like
+the one that the last 'merge-shards' saved).  Without it, every object counts
+the same.  The objects of the shard are listed in PILE_SHARD_FILE.
+
+Takes: int (shard to build, from 1 to count)
+       int (number of shards)
+       string (compile times file, or "")
+Returns: true on success
+         false on failure
+*/
+bool selectShard(int index, int count, const std::string& timesFile);
+
+/*
+Copies the objects that other shards built into this tree, along with how long
+they took to compile, so that this tree's compile times cover every shard.
+Each directory is the top of a tree that a shard was built in.
+
+Takes: list<string> (shard directories)
+       set<string> (the objects copied are stored here)
+Returns: true if every object was copied
+         false otherwise
+*/
+bool copyShardObjects(const std::list<std::string>& dirs, std::set<std::string>& copied);
+
+/*
+Makes sure that the shards built every object, then drops the jobs that would
+compile them again here.
+
+Takes: set<string> (the objects that the shards built)
+Returns: true if every object was built by a shard
+         false otherwise
+*/
+bool checkShardsMerged(const std::set<std::string>& copied);
+
+#endif
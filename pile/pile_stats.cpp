@@ -0,0 +1,124 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_stats.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains 'pile --stats', which reports how much work a run did (file
+system calls, scanning, interpreter work, the cache, and jobs) and how long
+each phase took.  goodio and Eve keep their own counts, since they don't know
+about Pile.
+*/
+
+#include "pile_global.h"
+#include "pile_stats.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_graph.h"
+#include "pile_system.h"
+#include "pile_ui.h"
+#include "Eve Source/eve_interpreter.h"
+#include "External Code/goodio.h"
+#include <fstream>
+
+unsigned long statCounters[NUM_STAT_COUNTERS];
+vector<pair<string, unsigned long> > phaseTimes;
+unsigned long statsStarted = 0;
+
+
+void startStats()
+{
+    for(int i = 0; i < NUM_STAT_COUNTERS; i++)
+        statCounters[i] = 0;
+    ioStatCount = 0;
+    Variable::created = 0;
+    Token::lexed = 0;
+    phaseTimes.clear();
+    statsStarted = getMilliseconds();
+}
+
+
+void addPhaseTime(const string& phase, unsigned long milliseconds)
+{
+    for(vector<pair<string, unsigned long> >::iterator e = phaseTimes.begin(); e != phaseTimes.end(); e++)
+    {
+        if(e->first == phase)
+        {
+            e->second += milliseconds;
+            return;
+        }
+    }
+    phaseTimes.push_back(make_pair(phase, milliseconds));
+}
+
+const vector<pair<string, unsigned long> >& getPhaseTimes()
+{
+    return phaseTimes;
+}
+
+unsigned long getRunMilliseconds()
+{
+    return getMilliseconds() - statsStarted;
+}
+
+bool reportStats()
+{
+    unsigned long totalMilliseconds = getRunMilliseconds();
+
+    // Names for the JSON and for people
+    const char* names[][2] = {
+        {"stat_calls", "File info lookups (stat/access)"},
+        {"files_scanned", "Files scanned for includes"},
+        {"includes_resolved", "Includes followed"},
+        {"depend_edges", "Include graph edges added"},
+        {"variables_created", "Pilefile variables made"},
+        {"tokens_lexed", "Pilefile tokens read"},
+        {"cache_hits", "Cache hits"},
+        {"cache_misses", "Cache misses"},
+        {"jobs_run", "Jobs run"},
+        {"jobs_skipped", "Jobs with nothing to do"},
+        {"jobs_failed", "Jobs that failed"}
+    };
+    unsigned long counts[] = {
+        ioStatCount,
+        statCounters[STAT_FILES_SCANNED],
+        statCounters[STAT_INCLUDES_RESOLVED],
+        statCounters[STAT_DEPEND_EDGES],
+        Variable::created,
+        Token::lexed,
+        statCounters[STAT_CACHE_HITS],
+        statCounters[STAT_CACHE_MISSES],
+        statCounters[STAT_JOBS_RUN],
+        statCounters[STAT_JOBS_SKIPPED],
+        statCounters[STAT_JOBS_FAILED]
+    };
+    unsigned int numCounts = sizeof(counts)/sizeof(counts[0]);
+
+    UI_print("\nStats:\n");
+    for(unsigned int i = 0; i < numCounts; i++)
+        UI_print(" %s: %lu\n", names[i][1], counts[i]);
+    for(vector<pair<string, unsigned long> >::iterator e = phaseTimes.begin(); e != phaseTimes.end(); e++)
+        UI_print(" %s: %lu ms\n", e->first.c_str(), e->second);
+    UI_print(" Total: %lu ms\n", totalMilliseconds);
+
+    mkpath(PILE_PROJECT_DIR);
+    ofstream fout(PILE_STATS_FILE, ios::trunc);
+    if(fout.fail())
+    {
+        UI_warning("Warning: Could not write %s\n", PILE_STATS_FILE);
+        return false;
+    }
+    fout << "{" << endl << "  \"counters\": {";
+    for(unsigned int i = 0; i < numCounts; i++)
+        fout << (i > 0? "," : "") << endl << "    \"" << names[i][0] << "\": " << counts[i];
+    fout << endl << "  }," << endl << "  \"phases_ms\": {";
+    for(vector<pair<string, unsigned long> >::iterator e = phaseTimes.begin(); e != phaseTimes.end(); e++)
+        fout << (e != phaseTimes.begin()? "," : "") << endl << "    \"" << e->first << "\": " << e->second;
+    fout << endl << "  }," << endl << "  \"total_ms\": " << totalMilliseconds << endl << "}" << endl;
+    return true;
+}
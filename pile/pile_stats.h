@@ -0,0 +1,76 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_stats.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_stats.cpp
+*/
+
+#ifndef _PILE_STATS_H__
+#define _PILE_STATS_H__
+
+#include <string>
+#include <vector>
+
+// Where 'pile --stats' leaves the numbers for other programs
+#define PILE_STATS_FILE ".pile/stats.json"
+
+// The things that Pile counts while it works
+enum StatCounter
+{
+    STAT_FILES_SCANNED,  // Files opened by readIncludes()
+    STAT_INCLUDES_RESOLVED,  // #include lines followed while scanning
+    STAT_DEPEND_EDGES,  // Dependencies added to the include graph
+    STAT_CACHE_HITS,
+    STAT_CACHE_MISSES,
+    STAT_JOBS_RUN,  // Jobs that ran a command
+    STAT_JOBS_SKIPPED,  // Jobs that had nothing to do or could not start
+    STAT_JOBS_FAILED,
+    NUM_STAT_COUNTERS
+};
+
+extern unsigned long statCounters[NUM_STAT_COUNTERS];
+
+// Adds to a counter.  This is cheap enough for the busiest loops.
+inline void countStat(StatCounter counter, unsigned long amount = 1)
+{
+    statCounters[counter] += amount;
+}
+
+/*
+Starts counting a run from zero.  It is called when Pile starts and when a
+build is started by piled or 'pile watch', so each build gets its own numbers.
+*/
+void startStats();
+
+/*
+Adds time to a phase of the run, like reading the pilefile.  Phases are
+reported in the order they first got time.
+
+Takes: string (phase name)
+       unsigned long (milliseconds)
+*/
+void addPhaseTime(const std::string& phase, unsigned long milliseconds);
+
+// Gets the time of each phase, in the order they first got time.
+const std::vector<std::pair<std::string, unsigned long> >& getPhaseTimes();
+
+// Gets the milliseconds since startStats().
+unsigned long getRunMilliseconds();
+
+/*
+Prints the counters, the time of each phase, and the time since startStats(),
+and writes them to .pile/stats.json.
+
+Returns: true on success
+         false if the file could not be written
+*/
+bool reportStats();
+
+#endif
@@ -25,11 +25,17 @@ This file contains all system-specific functions used in Pile.
 #endif
 
 #ifdef PILE_LINUX
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
 /*#include <Xm/Xm.h>
 #include <Xm/PushB.h>*/
 #endif
 
 #include "pile_ui.h"
+#include "External Code/goodio.h"
 #include "cstdio"
 
 
@@ -151,9 +157,212 @@ int systemCall(string command)
     return result;
 }
 
+/*
+Wraps a command so that it is run from another directory.  The working
+directory of Pile itself is unchanged, so output redirection still goes to
+the usual place.
+
+Takes: string (directory to run in)
+       string (command)
+Returns: string (wrapped command)
+*/
+string runInDirectory(const string& dir, const string& command)
+{
+    if(dir == "")
+        return command;
+    
+    string quotedDir = dir;
+    if(quotedDir.find_first_of(' ') != string::npos)
+        quotedDir = "\"" + quotedDir + "\"";
+    
+    #ifdef PILE_WIN32
+    return "(cd /d " + quotedDir + " && " + command + ")";
+    #else
+    return "(cd " + quotedDir + " && " + command + ")";
+    #endif
+}
+
 void delay(unsigned int milliseconds)
 {
     #ifdef PILE_WIN32
     Sleep(milliseconds);
     #endif
 }
+
+#ifdef PILE_WIN32
+// Results of commands which already ran, waiting to be collected
+static list<pair<int, int> > finishedCommands;
+static int nextCommandID = 1;
+#endif
+
+int startCommand(const string& command, const string& outputFile)
+{
+    #ifdef PILE_WIN32
+    ioDelete(outputFile);
+    int result = system((command + " > " + outputFile + " 2>&1").c_str());
+    finishedCommands.push_back(make_pair(nextCommandID, result));
+    return nextCommandID++;
+    #endif
+    
+    #ifdef PILE_LINUX
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        int fd = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd >= 0)
+        {
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    return pid;
+    #endif
+}
+
+int waitForCommand(int& result)
+{
+    CommandUsage usage;
+    return waitForCommand(result, usage);
+}
+
+int waitForCommand(int& result, CommandUsage& usage)
+{
+    usage = CommandUsage();
+    #ifdef PILE_WIN32
+    if(finishedCommands.size() == 0)
+        return -1;
+    int id = finishedCommands.front().first;
+    result = finishedCommands.front().second;
+    finishedCommands.pop_front();
+    return id;
+    #endif
+    
+    #ifdef PILE_LINUX
+    int status = 0;
+    struct rusage used;
+    pid_t pid = wait4(-1, &status, 0, &used);
+    if(pid < 0)
+        return -1;
+    usage.userMilliseconds = used.ru_utime.tv_sec*1000UL + used.ru_utime.tv_usec/1000;
+    usage.systemMilliseconds = used.ru_stime.tv_sec*1000UL + used.ru_stime.tv_usec/1000;
+    usage.maxMemoryKB = used.ru_maxrss;
+    if(WIFEXITED(status))
+        result = WEXITSTATUS(status);
+    else
+        result = -1;
+    return pid;
+    #endif
+}
+
+unsigned long getMilliseconds()
+{
+    #ifdef PILE_WIN32
+    return GetTickCount();
+    #endif
+    
+    #ifdef PILE_LINUX
+    timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec*1000UL + now.tv_usec/1000;
+    #endif
+}
+
+unsigned long long getMicroseconds()
+{
+    #ifdef PILE_WIN32
+    return GetTickCount()*1000ULL;
+    #endif
+    
+    #ifdef PILE_LINUX
+    timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec*1000000ULL + now.tv_usec;
+    #endif
+}
+
+long getPeakMemoryKB()
+{
+    #ifdef PILE_LINUX
+    struct rusage used;
+    if(getrusage(RUSAGE_SELF, &used) == 0)
+        return used.ru_maxrss;
+    #endif
+    return 0;
+}
+
+int getCPUCount()
+{
+    #ifdef PILE_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+    #endif
+    
+    #ifdef PILE_LINUX
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count < 1)
+        return 1;
+    return count;
+    #endif
+}
+
+bool isInPath(const string& program)
+{
+    const char* path = getenv("PATH");
+    if(path == NULL)
+        return false;
+    
+    #ifdef PILE_WIN32
+    list<string> dirs = ioExplode(path, ';');
+    string ext = ".exe";
+    #else
+    list<string> dirs = ioExplode(path, ':');
+    string ext = "";
+    #endif
+    for(list<string>::iterator e = dirs.begin(); e != dirs.end(); e++)
+    {
+        if(*e != "" && ioExists(*e + "/" + program + ext))
+            return true;
+    }
+    return false;
+}
+
+bool hardLink(const string& source, const string& dest)
+{
+    ioDelete(dest);
+    
+    #ifdef PILE_WIN32
+    if(CreateHardLinkA(dest.c_str(), source.c_str(), NULL))
+        return true;
+    #endif
+    
+    #ifdef PILE_LINUX
+    if(link(source.c_str(), dest.c_str()) == 0)
+        return true;
+    #endif
+    
+    // Some file systems have no hard links.
+    return ioCopy(source, dest);
+}
+
+string getExecutablePath()
+{
+    char buff[4096];
+    
+    #ifdef PILE_WIN32
+    DWORD size = GetModuleFileNameA(NULL, buff, sizeof(buff));
+    if(size > 0 && size < sizeof(buff))
+        return string(buff, size);
+    #endif
+    
+    #ifdef PILE_LINUX
+    ssize_t size = readlink("/proc/self/exe", buff, sizeof(buff) - 1);
+    if(size > 0)
+        return string(buff, size);
+    #endif
+    
+    return "pile";
+}
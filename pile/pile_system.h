@@ -27,6 +27,7 @@ Header for pile_system.cpp
 
 #ifdef PILE_WIN32
     #define EXE_EXT ".exe"
+    #define SHARED_LIB_EXT ".dll"
     #define DEFAULT_EDITOR "c:/windows/notepad.exe"
     #define DEFAULT_C_COMPILER ""
     #define DEFAULT_C_LINKER_D ""
@@ -48,6 +49,7 @@ Header for pile_system.cpp
 
 #ifdef PILE_LINUX
     #define EXE_EXT ""
+    #define SHARED_LIB_EXT ".so"
     #define DEFAULT_EDITOR "vi"
     #define DEFAULT_C_COMPILER "gcc"
     #define DEFAULT_C_LINKER_D "gcc"
@@ -77,10 +79,87 @@ inline std::string getConfigDir()
 
 void convertSlashes(std::string& str);
 
+// Longer lists of files are passed to tools in a response file (@file).  The
+// Windows command line stops at 8191 characters.
+#define PILE_MAX_COMMAND_LENGTH 8000
+
 int systemCall(std::string command);
 
+std::string runInDirectory(const std::string& dir, const std::string& command);
+
+/*
+Starts a command without waiting for it.  Its stdout and stderr go into the
+given file.  Where processes cannot be started in the background, the command
+is run right away.
+
+Takes: string (command)
+       string (output file name)
+Returns: int (an id for waitForCommand(), or -1 on failure)
+*/
+int startCommand(const std::string& command, const std::string& outputFile);
+
+/*
+Waits for any command started by startCommand() to end.
+
+Takes: int (the command's result is stored here, 0 on success)
+Returns: int (the id of the command that ended, or -1 if none are running)
+*/
+int waitForCommand(int& result);
+
+// What a command used, where the system can tell (zero otherwise)
+struct CommandUsage
+{
+    unsigned long userMilliseconds;
+    unsigned long systemMilliseconds;
+    long maxMemoryKB;  // Peak resident memory
+
+    CommandUsage()
+        : userMilliseconds(0)
+        , systemMilliseconds(0)
+        , maxMemoryKB(0)
+    {}
+};
+
+/*
+Waits for any command started by startCommand() to end, and gets what it used.
+
+Takes: int (the command's result is stored here, 0 on success)
+       CommandUsage (what it used is stored here)
+Returns: int (the id of the command that ended, or -1 if none are running)
+*/
+int waitForCommand(int& result, CommandUsage& usage);
+
 void delay(unsigned int milliseconds);
 
+// Gets a time in milliseconds, for measuring how long things take.
+unsigned long getMilliseconds();
+
+// Gets a time in microseconds, for measuring short things.
+unsigned long long getMicroseconds();
+
+// Gets the peak memory that Pile itself has used, in KB (0 if unknown).
+long getPeakMemoryKB();
+
+// Gets the number of processors that are online.
+int getCPUCount();
+
+// Looks for a program in the directories of the PATH environment variable.
+bool isInPath(const std::string& program);
+
+/*
+Makes a file another name for an existing file.  If the file system cannot do
+that, the file is copied.
+
+Takes: string (existing file name)
+       string (new file name, replaced if it exists)
+Returns: true on success
+         false on failure
+*/
+bool hardLink(const std::string& source, const std::string& dest);
+
+// Gets the full path of the running Pile program, so it can start itself.
+std::string getExecutablePath();
+
 std::string getSystemName();
 
 void SYS_alert(const char* text);
@@ -0,0 +1,311 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_timing.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the reading of what compilers report about their own time,
+for compilers with 'timing' set.  Each compile's report is added to the totals
+for the build, which go into the trace and the history.
+
+Clang (-ftime-trace) writes Chrome trace events beside the object.  The
+"Total ..." events sum up each kind of work, and each "Source" event is the
+time spent in one header (and what it includes).  Gcc (-ftime-report) prints a
+table with a line for each kind of work, where the third number is the wall
+time in seconds.  It doesn't say anything about headers.
+*/
+
+#include "pile_global.h"
+#include "pile_timing.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_compiler.h"
+#include "pile_trace.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+string numberText(long number);
+
+CompilerTiming compilerTiming;  // This build's totals
+
+
+string compilerTimingOption(const string& compiler)
+{
+    CompilerFamily family = getCompilerFamily(compiler);
+    if(family == COMPILER_CLANG)
+        return "-ftime-trace";
+    if(family == COMPILER_GCC)
+        return "-ftime-report";
+    return "";
+}
+
+bool timingIsWrittenToFile(const string& compiler)
+{
+    return (compilerTimingOption(compiler) == "-ftime-trace");
+}
+
+// Splits a Chrome trace into its events, which are the objects in its list.
+vector<string> readTraceEvents(const string& text)
+{
+    vector<string> events;
+    int depth = 0;
+    bool inString = false;
+    string::size_type start = 0;
+    for(string::size_type i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if(inString)
+        {
+            if(c == '\\')
+                i++;
+            else if(c == '"')
+                inString = false;
+        }
+        else if(c == '"')
+            inString = true;
+        else if(c == '{')
+        {
+            depth++;
+            if(depth == 2)
+                start = i;
+        }
+        else if(c == '}')
+        {
+            if(depth == 2)
+                events.push_back(text.substr(start, i + 1 - start));
+            depth--;
+        }
+    }
+    return events;
+}
+
+/*
+Gets a value from a trace event.  The keys in an event's args are looked for
+too, since none of them share a name with the event's own keys.
+
+Takes: string (the event)
+       string (key)
+Returns: string (the value, without quotes, or "" if it isn't there)
+*/
+string traceEventValue(const string& event, const string& key)
+{
+    string::size_type pos = event.find("\"" + key + "\":");
+    if(pos == string::npos)
+        return "";
+    pos += key.size() + 3;
+    while(pos < event.size() && event[pos] == ' ')
+        pos++;
+    if(pos >= event.size())
+        return "";
+    if(event[pos] != '"')
+        return event.substr(pos, event.find_first_of(",}", pos) - pos);
+
+    string result;
+    for(pos++; pos < event.size() && event[pos] != '"'; pos++)
+    {
+        if(event[pos] == '\\' && pos + 1 < event.size())
+        {
+            pos++;
+            if(event[pos] == 'n')
+                result += '\n';
+            else if(event[pos] == 't')
+                result += '\t';
+            else
+                result += event[pos];
+        }
+        else
+            result += event[pos];
+    }
+    return result;
+}
+
+// Reads clang's report for one object.
+bool readClangTiming(const string& object, CompilerTiming& timing)
+{
+    string text = readFile(getBaseName(object) + ".json");
+    if(text == "")
+        return false;
+
+    // Times are in microseconds until the end.
+    unsigned long long parsing = 0;
+    unsigned long long templates = 0;
+    unsigned long long optimizing = 0;
+    map<string, unsigned long long> headers;
+    string cwd = ioGetCWD();
+    vector<string> events = readTraceEvents(text);
+    for(vector<string>::iterator e = events.begin(); e != events.end(); e++)
+    {
+        string name = traceEventValue(*e, "name");
+        unsigned long long duration = strtoull(traceEventValue(*e, "dur").c_str(), NULL, 10);
+        if(name == "Source")
+            headers[relativeToDir(cwd, absolutePath(traceEventValue(*e, "detail")))] += duration;
+        else if(name == "Total Frontend")
+            parsing += duration;
+        else if(name == "Total InstantiateFunction" || name == "Total InstantiateClass")
+            templates += duration;
+        else if(name == "Total Backend")
+            optimizing += duration;
+    }
+
+    timing.parsing += parsing / 1000;
+    timing.templates += templates / 1000;
+    timing.optimizing += optimizing / 1000;
+    for(map<string, unsigned long long>::iterator e = headers.begin(); e != headers.end(); e++)
+        timing.headers[e->first] += e->second / 1000;
+    return true;
+}
+
+// Gets the wall time, in seconds, from the numbers after the colon of a line
+// of gcc's report.  Percentages and memory sizes are skipped.
+double readWallSeconds(const string& columns)
+{
+    stringstream str(columns);
+    string word;
+    int numbers = 0;
+    while(str >> word)
+    {
+        if(word.find_first_of("(%)") != string::npos)
+            continue;
+        char* end = NULL;
+        double value = strtod(word.c_str(), &end);
+        if(end == word.c_str() || *end != '\0')
+            continue;
+        if(++numbers == 3)
+            return value;
+    }
+    return 0;
+}
+
+/*
+Reads gcc's reports out of a command's output.  A batch has one for each
+source.
+
+Takes: string (the output, which has the reports taken out of it)
+       CompilerTiming (the times are added here)
+Returns: int (number of reports found)
+*/
+int readGccTiming(string& output, CompilerTiming& timing)
+{
+    stringstream in(output);
+    string rest;
+    string line;
+    int reports = 0;
+    bool inReport = false;
+    while(getline(in, line))
+    {
+        if(!inReport)
+        {
+            if(line.compare(0, 13, "Time variable") != 0 && line.compare(0, 15, "Execution times") != 0)
+            {
+                rest += line + "\n";
+                continue;
+            }
+            // The report starts after a blank line.
+            if(rest == "\n" || (rest.size() > 1 && rest.compare(rest.size() - 2, 2, "\n\n") == 0))
+                rest.erase(rest.size() - 1);
+            inReport = true;
+            reports++;
+            continue;
+        }
+
+        string::size_type colon = line.find(':');
+        if(colon == string::npos)
+            continue;
+        string::size_type first = line.find_first_not_of(" |");
+        string::size_type last = line.find_last_not_of(" ", colon - 1);
+        string name = (first < colon? line.substr(first, last + 1 - first) : "");
+        unsigned long ms = (unsigned long)(readWallSeconds(line.substr(colon + 1)) * 1000 + 0.5);
+        if(name == "phase parsing" || name == "phase lang. deferred")
+            timing.parsing += ms;
+        else if(name == "template instantiation")
+            timing.templates += ms;
+        else if(name == "phase opt and generate")
+            timing.optimizing += ms;
+        else if(name == "TOTAL")
+            inReport = false;
+    }
+    output = rest;
+    return reports;
+}
+
+bool readCompilerTiming(const string& compiler, const list<string>& objects, const string& outputFile, map<string, string>& details)
+{
+    CompilerTiming timing;
+    if(timingIsWrittenToFile(compiler))
+    {
+        for(list<string>::const_iterator e = objects.begin(); e != objects.end(); e++)
+        {
+            if(readClangTiming(*e, timing))
+                timing.sources++;
+        }
+    }
+    else
+    {
+        string output = readFile(outputFile);
+        timing.sources = readGccTiming(output, timing);
+        if(timing.sources > 0)
+        {
+            ofstream fout(outputFile.c_str(), ios::trunc);
+            fout << output;
+        }
+    }
+    if(timing.sources == 0)
+    {
+        UI_debug_pile("No compiler timing was found for %s\n", objects.front().c_str());
+        return false;
+    }
+
+    details["parsing ms"] = numberText(long(timing.parsing));
+    details["templates ms"] = numberText(long(timing.templates));
+    details["optimizing ms"] = numberText(long(timing.optimizing));
+
+    compilerTiming.sources += timing.sources;
+    compilerTiming.parsing += timing.parsing;
+    compilerTiming.templates += timing.templates;
+    compilerTiming.optimizing += timing.optimizing;
+    for(map<string, unsigned long>::iterator e = timing.headers.begin(); e != timing.headers.end(); e++)
+        compilerTiming.headers[e->first] += e->second;
+    return true;
+}
+
+vector<pair<unsigned long, string> > getSlowestHeaders(const CompilerTiming& timing)
+{
+    vector<pair<unsigned long, string> > result;
+    for(map<string, unsigned long>::const_iterator e = timing.headers.begin(); e != timing.headers.end(); e++)
+        result.push_back(make_pair(e->second, e->first));
+    sort(result.rbegin(), result.rend());
+    return result;
+}
+
+const CompilerTiming& getCompilerTiming()
+{
+    return compilerTiming;
+}
+
+void traceCompilerTiming()
+{
+    if(!tracing() || compilerTiming.sources == 0)
+        return;
+
+    map<string, string> args;
+    args["sources"] = numberText(compilerTiming.sources);
+    args["parsing ms"] = numberText(long(compilerTiming.parsing));
+    args["templates ms"] = numberText(long(compilerTiming.templates));
+    args["optimizing ms"] = numberText(long(compilerTiming.optimizing));
+
+    vector<pair<unsigned long, string> > slowest = getSlowestHeaders(compilerTiming);
+    for(unsigned int i = 0; i < slowest.size() && i < PILE_TIMING_HEADERS; i++)
+        args["header " + slowest[i].second] = numberText(long(slowest[i].first)) + " ms";
+    traceMark("Compiler timing", "compiler", args);
+}
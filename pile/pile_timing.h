@@ -0,0 +1,91 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_timing.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_timing.cpp
+*/
+
+#ifndef _PILE_TIMING_H__
+#define _PILE_TIMING_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+// How many of the slowest headers are kept in the history for each build
+#define PILE_TIMING_HEADERS 20
+
+/*
+Where the compilers of this build spent their time, in milliseconds, as they
+reported it.  Template instantiation is part of parsing.
+*/
+struct CompilerTiming
+{
+    int sources;  // Compiles that reported their time
+    unsigned long parsing;  // The front end
+    unsigned long templates;
+    unsigned long optimizing;  // Optimizing and generating code
+    std::map<std::string, unsigned long> headers;  // Time in each header (clang only)
+
+    CompilerTiming()
+        : sources(0), parsing(0), templates(0), optimizing(0)
+    {}
+};
+
+/*
+Gets the option that makes a compiler report where its time goes:
+-ftime-trace for clang and -ftime-report for gcc.
+
+Takes: string (compiler path)
+Returns: string (the option, or "" if the compiler has none that Pile reads)
+*/
+std::string compilerTimingOption(const std::string& compiler);
+
+/*
+Tells whether a compiler writes its timing next to the objects (like clang), so
+that it can't be read when the compile runs on a pile-worker.
+
+Takes: string (compiler path)
+Returns: true if it does
+         false otherwise
+*/
+bool timingIsWrittenToFile(const std::string& compiler);
+
+/*
+Reads what a compiler reported about its time and adds it to this build's
+totals.  Clang's report is the .json beside each object.  Gcc's is in the
+command's output, and it is taken out of the output so that it isn't printed.
+
+Takes: string (compiler path)
+       list<string> (object file names)
+       string (file with the command's output)
+       map<string, string> (the times found are stored here, for the trace)
+Returns: true if a report was found
+         false otherwise
+*/
+bool readCompilerTiming(const std::string& compiler, const std::list<std::string>& objects, const std::string& outputFile, std::map<std::string, std::string>& details);
+
+/*
+Gets the headers that the compilers spent the most time in.
+
+Takes: CompilerTiming (the times)
+Returns: vector<pair<unsigned long, string> > (milliseconds and header, slowest
+         first)
+*/
+std::vector<std::pair<unsigned long, std::string> > getSlowestHeaders(const CompilerTiming& timing);
+
+// Gets the compiler times of this build.
+const CompilerTiming& getCompilerTiming();
+
+// Adds the compiler times of this build to the trace.
+void traceCompilerTiming();
+
+#endif
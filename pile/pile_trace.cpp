@@ -0,0 +1,185 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_trace.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains 'pile --trace', which records where the time of a build
+goes (reading pile.conf and the pilefile, scanning, checking, and each job)
+and writes it as Chrome trace events.  Pile's own work is on lane 0, and each
+job slot has its own lane after that.
+*/
+
+#include "pile_global.h"
+#include "pile_trace.h"
+#include "pile_system.h"
+#include "pile_ui.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef PILE_LINUX
+#include <unistd.h>
+#endif
+
+string traceFile;
+unsigned long long traceOrigin = 0;
+vector<string> traceEvents;  // Each one is a JSON object
+map<int, string> traceLanes;
+
+
+// Makes a string safe to put in JSON quotes.
+string jsonString(const string& text)
+{
+    string result = "\"";
+    for(unsigned int i = 0; i < text.size(); i++)
+    {
+        unsigned char c = text[i];
+        if(c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if(c == '\n')
+            result += "\\n";
+        else if(c == '\t')
+            result += "\\t";
+        else if(c < 0x20)
+        {
+            char buff[8];
+            sprintf(buff, "\\u%04x", c);
+            result += buff;
+        }
+        else
+            result += c;
+    }
+    return result + "\"";
+}
+
+int traceProcess()
+{
+    #ifdef PILE_LINUX
+    return getpid();
+    #else
+    return 1;
+    #endif
+}
+
+void startTrace(const string& file)
+{
+    if(traceFile == "")
+        traceOrigin = getMicroseconds();
+    traceFile = file;
+}
+
+bool tracing()
+{
+    return (traceFile != "");
+}
+
+unsigned long long traceTime()
+{
+    return getMicroseconds() - traceOrigin;
+}
+
+void traceBegin(const string& name, const string& category)
+{
+    if(!tracing())
+        return;
+    stringstream str;
+    str << "{\"name\":" << jsonString(name) << ",\"cat\":" << jsonString(category)
+        << ",\"ph\":\"B\",\"ts\":" << traceTime() << ",\"pid\":" << traceProcess() << ",\"tid\":0}";
+    traceEvents.push_back(str.str());
+}
+
+void traceEnd()
+{
+    if(!tracing())
+        return;
+    stringstream str;
+    str << "{\"ph\":\"E\",\"ts\":" << traceTime() << ",\"pid\":" << traceProcess() << ",\"tid\":0}";
+    traceEvents.push_back(str.str());
+}
+
+// Writes the details of an event as JSON.
+string jsonArgs(const map<string, string>& args)
+{
+    string result = "{";
+    for(map<string, string>::const_iterator e = args.begin(); e != args.end(); e++)
+    {
+        if(e != args.begin())
+            result += ",";
+        result += jsonString(e->first) + ":" + jsonString(e->second);
+    }
+    return result + "}";
+}
+
+void traceSpan(const string& name, const string& category, int lane, unsigned long long start, const map<string, string>& args)
+{
+    if(!tracing())
+        return;
+    stringstream str;
+    str << "{\"name\":" << jsonString(name) << ",\"cat\":" << jsonString(category)
+        << ",\"ph\":\"X\",\"ts\":" << start << ",\"dur\":" << traceTime() - start
+        << ",\"pid\":" << traceProcess() << ",\"tid\":" << lane << ",\"args\":" << jsonArgs(args) << "}";
+    traceEvents.push_back(str.str());
+}
+
+void traceMark(const string& name, const string& category, const map<string, string>& args)
+{
+    if(!tracing())
+        return;
+    stringstream str;
+    str << "{\"name\":" << jsonString(name) << ",\"cat\":" << jsonString(category)
+        << ",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << traceTime()
+        << ",\"pid\":" << traceProcess() << ",\"tid\":0,\"args\":" << jsonArgs(args) << "}";
+    traceEvents.push_back(str.str());
+}
+
+void nameTraceLane(int lane, const string& name)
+{
+    if(tracing())
+        traceLanes[lane] = name;
+}
+
+bool writeTrace()
+{
+    if(!tracing())
+        return true;
+
+    ofstream fout(traceFile.c_str(), ios::trunc);
+    if(fout.fail())
+    {
+        UI_error("pile error: Could not write the trace to %s\n", traceFile.c_str());
+        return false;
+    }
+
+    // Lanes are shown in order, with their names.
+    traceLanes[0] = "pile";
+    fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+    fout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << traceProcess() << ",\"args\":{\"name\":\"pile\"}}";
+    for(map<int, string>::iterator e = traceLanes.begin(); e != traceLanes.end(); e++)
+    {
+        fout << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << traceProcess() << ",\"tid\":" << e->first
+             << ",\"args\":{\"name\":" << jsonString(e->second) << "}}";
+        fout << "," << endl << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" << traceProcess() << ",\"tid\":" << e->first
+             << ",\"args\":{\"sort_index\":" << e->first << "}}";
+    }
+    for(vector<string>::iterator e = traceEvents.begin(); e != traceEvents.end(); e++)
+        fout << "," << endl << *e;
+    fout << endl << "]}" << endl;
+
+    fout.close();
+    if(fout.fail())
+    {
+        UI_error("pile error: Could not write the trace to %s\n", traceFile.c_str());
+        return false;
+    }
+    UI_print("Wrote the trace to %s\n", traceFile.c_str());
+    return true;
+}
@@ -0,0 +1,104 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_trace.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_trace.cpp
+*/
+
+#ifndef _PILE_TRACE_H__
+#define _PILE_TRACE_H__
+
+#include <map>
+#include <string>
+
+/*
+Starts recording what this run of Pile does, for writeTrace().  Times are
+counted from the first call, so calling it again only changes the file.
+
+Takes: string (trace file name)
+*/
+void startTrace(const std::string& file);
+
+// Tells whether startTrace() was called.
+bool tracing();
+
+// Gets the time in the trace, in microseconds.
+unsigned long long traceTime();
+
+/*
+Starts a span of time on Pile's own lane.  Spans nest, and each one is ended
+by traceEnd().
+
+Takes: string (name)
+       string (category, like "pilefile" or "scan")
+*/
+void traceBegin(const std::string& name, const std::string& category);
+
+// Ends the span started last by traceBegin().
+void traceEnd();
+
+/*
+Records a span that is over, like a job, on its own lane.
+
+Takes: string (name)
+       string (category)
+       int (lane, where 0 is Pile's own)
+       unsigned long long (start, from traceTime())
+       map<string, string> (details shown with it, like the command)
+*/
+void traceSpan(const std::string& name, const std::string& category, int lane, unsigned long long start, const std::map<std::string, std::string>& args);
+
+/*
+Records a moment on Pile's own lane, like a summary at the end of the build.
+
+Takes: string (name)
+       string (category)
+       map<string, string> (details shown with it)
+*/
+void traceMark(const std::string& name, const std::string& category, const std::map<std::string, std::string>& args);
+
+/*
+Names a lane, like "slot 2".
+
+Takes: int (lane)
+       string (name)
+*/
+void nameTraceLane(int lane, const std::string& name);
+
+/*
+Writes the trace as Chrome trace events, which chrome://tracing and Perfetto
+can show.
+
+Returns: true on success (or if there is no trace)
+         false on failure
+*/
+bool writeTrace();
+
+// Traces the time until it goes out of scope.
+class TraceScope
+{
+    public:
+    bool traced;
+
+    TraceScope(const std::string& name, const std::string& category)
+        : traced(tracing())
+    {
+        if(traced)
+            traceBegin(name, category);
+    }
+
+    ~TraceScope()
+    {
+        if(traced)
+            traceEnd();
+    }
+};
+
+#endif
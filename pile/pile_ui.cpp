@@ -357,7 +357,7 @@ void UI_print(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -384,7 +384,7 @@ void UI_output(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -411,7 +411,7 @@ void UI_warning(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -439,7 +439,7 @@ void UI_error(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -467,7 +467,7 @@ void UI_debug(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -495,7 +495,7 @@ void UI_debug_pile(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     #ifndef PILE_NO_GUI
@@ -527,7 +527,7 @@ void UI_log(const char* formatted_text, ...)
 
     va_list lst;
     va_start(lst, formatted_text);
-    vsprintf(ui_buffer, formatted_text, lst);
+    vsnprintf(ui_buffer, PILE_PRINT_BUFFER_SIZE, formatted_text, lst);
     va_end(lst);
 
     if(ui_log)
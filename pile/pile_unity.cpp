@@ -0,0 +1,262 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_unity.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains the functions which generate unity (jumbo) source files.
+A unity file #includes several sources so that the headers they share are only
+parsed once.
+*/
+
+#include "pile_global.h"
+#include "pile_config.h"
+#include "pile_unity.h"
+#include "pile_commands.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+string getExtension(const string& file);
+
+set<string> unityRoots;  // Where unity files were made this run, with a slash
+set<string> unityFilesMade;  // Without extensions, so their objects count too
+
+
+bool isUnityUnsafe(const string& file)
+{
+    ifstream fin(file.c_str());
+    if(fin.fail())
+        return false;
+
+    string line;
+    while(getline(fin, line))
+    {
+        if(line.find("pile: no-unity") != string::npos)
+            return true;
+    }
+    return false;
+}
+
+bool isUnitySource(const string& file, const string& objPath)
+{
+    string dir = addDirSlash(objPath) + "unity/";
+    return (file.substr(0, dir.size()) == dir);
+}
+
+// Gets the name of a unity file, without the extension, from the file at the
+// boundary that started its run of buckets and its place in that run.
+string unityName(const string& boundary, int index)
+{
+    stringstream name;
+    name << "unity_" << hashToString(hashString(boundary)) << "_" << index;
+    return name.str();
+}
+
+list<string> makeUnitySources(const list<string>& sources, int unitySize, const string& objPath, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    list<string> result;
+    unityRoots.insert(addDirSlash(objPath) + "unity/");
+
+    // Group by directory and language.  Everything in one compile() call
+    // already shares the compiler and options.
+    map<string, vector<string> > groups;
+    for(list<string>::const_iterator e = sources.begin(); e != sources.end(); e++)
+    {
+        string ext = getExtension(*e);
+        if(!(isCExt(ext) || isCPPExt(ext)) || isUnityUnsafe(*e))
+        {
+            result.push_back(*e);
+            continue;
+        }
+        groups[ioStripToDir(*e) + (isCExt(ext)? "|.c" : "|.cpp")].push_back(*e);
+    }
+
+    /*
+    Weigh each source by the headers it pulls in.  A header that many of
+    these sources include costs little per source once they are merged, but a
+    header that only one source includes costs as much as a whole source.  So
+    each header adds 1/fan-in to the weight of the sources that include it.
+    The weights are then scaled so that an average source weighs 1.
+    */
+    map<string, set<FileData*> > closures;
+    map<FileData*, int> fanIn;
+    map<string, float> weights;
+    for(map<string, vector<string> >::iterator g = groups.begin(); g != groups.end(); g++)
+    {
+        for(vector<string>::iterator e = g->second.begin(); e != g->second.end(); e++)
+        {
+            map<string, FileData*>::iterator fd = fileDataHash.find(*e);
+            if(fd == fileDataHash.end() || fd->second == NULL)
+                continue;
+            set<FileData*>& closure = closures[*e];
+            collectDepends(depends, fd->second, closure);
+            for(set<FileData*>::iterator h = closure.begin(); h != closure.end(); h++)
+                fanIn[*h]++;
+        }
+    }
+    
+    float totalWeight = 0.0f;
+    for(map<string, vector<string> >::iterator g = groups.begin(); g != groups.end(); g++)
+    {
+        for(vector<string>::iterator e = g->second.begin(); e != g->second.end(); e++)
+        {
+            float weight = 1.0f;
+            set<FileData*>& closure = closures[*e];
+            for(set<FileData*>::iterator h = closure.begin(); h != closure.end(); h++)
+            {
+                if((*h)->exists() && fanIn[*h] > 0)
+                    weight += 1.0f / fanIn[*h];
+            }
+            weights[*e] = weight;
+            totalWeight += weight;
+        }
+    }
+    for(map<string, float>::iterator e = weights.begin(); e != weights.end(); e++)
+        e->second *= weights.size() / totalWeight;
+
+    for(map<string, vector<string> >::iterator g = groups.begin(); g != groups.end(); g++)
+    {
+        vector<string>& files = g->second;
+        sort(files.begin(), files.end());
+
+        string ext = g->first.substr(g->first.find_last_of('|') + 1);
+        string unityDir = addDirSlash(objPath) + "unity/" + addDirSlash(ioStripToDir(files[0]));
+
+        /*
+        Split the group into buckets.  A bucket is closed when it is full or
+        when the next file's name hashes to a boundary.  The boundaries depend
+        only on the names, so adding or removing a file only disturbs the
+        buckets around it and an edit only rebuilds its own bucket.
+
+        Each bucket is named by a hash of the file at the boundary that
+        started its run (or "" for the first run) and its place in that run,
+        so the names stay the same when files come and go elsewhere.
+        */
+        vector<vector<string> > buckets(1);
+        vector<string> names(1, unityName("", 0));
+        string boundaryName;
+        int index = 0;
+        float bucketWeight = 0.0f;
+        for(vector<string>::iterator e = files.begin(); e != files.end(); e++)
+        {
+            float weight = weights[*e];
+            bool boundary = (hashString(ioStripToFile(*e)) % unitySize == 0 && bucketWeight >= unitySize/2.0f);
+            if(buckets.back().size() > 0 && (bucketWeight + weight > unitySize + 0.01f || boundary))
+            {
+                if(boundary)
+                {
+                    boundaryName = ioStripToFile(*e);
+                    index = 0;
+                }
+                else
+                    index++;
+                buckets.push_back(vector<string>());
+                names.push_back(unityName(boundaryName, index));
+                bucketWeight = 0.0f;
+            }
+            buckets.back().push_back(*e);
+            bucketWeight += weight;
+        }
+
+        for(unsigned int i = 0; i < buckets.size(); i++)
+        {
+            vector<string>& b = buckets[i];
+            if(b.size() == 1)
+            {
+                result.push_back(b.front());
+                continue;
+            }
+
+            string unityFile = unityDir + names[i] + ext;
+            mkpath(unityDir);
+            unityFilesMade.insert(getBaseName(unityFile));
+
+            string text = "// Generated by pile.  Do not edit.\n";
+            for(vector<string>::iterator e = b.begin(); e != b.end(); e++)
+                text += "#include \"" + pathFromDir(unityDir, *e) + "\"\n";
+
+            if(writeIfChanged(unityFile, text))
+                UI_debug_pile("Wrote unity file %s\n", unityFile.c_str());
+
+            // The unity file depends on its members, so it is out of date
+            // whenever one of them is.  Another compile() (or an earlier
+            // build kept by piled) may have made its file data already.
+            FileData* fd = fileDataHash[unityFile];
+            if(fd == NULL)
+            {
+                fd = new FileData(unityFile);
+                fileDataHash[unityFile] = fd;
+            }
+            else
+            {
+                fd->checkExistence();
+                fd->checkTime();
+            }
+            list<FileData*>& members = depends[fd];
+            members.clear();
+            for(vector<string>::iterator e = b.begin(); e != b.end(); e++)
+            {
+                FileData* member = fileDataHash[*e];
+                if(member == NULL)
+                {
+                    member = new FileData(*e);
+                    fileDataHash[*e] = member;
+                }
+                members.push_back(member);
+                if(fd->getDependTime() < member->getDependTime())
+                    fd->setDependTime(member->getDependTime());
+            }
+
+            result.push_back(unityFile);
+        }
+    }
+
+    return result;
+}
+
+// Deletes the unity files (and their objects) under a directory that were not
+// made this run.
+void removeStaleUnityFiles(const string& dir, map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    if(!ioIsDir(dir))
+        return;
+    list<string> names = ioList(dir, true, true);
+    for(list<string>::iterator e = names.begin(); e != names.end(); e++)
+    {
+        if(*e == "." || *e == "..")
+            continue;
+        string file = dir + *e;
+        if(ioIsDir(file))
+        {
+            removeStaleUnityFiles(addDirSlash(file), depends, fileDataHash);
+            continue;
+        }
+        if(e->substr(0, 6) != "unity_" || unityFilesMade.find(getBaseName(file)) != unityFilesMade.end())
+            continue;
+
+        UI_debug_pile("Removing old unity file %s\n", file.c_str());
+        ioDelete(file);
+        map<string, FileData*>::iterator fd = fileDataHash.find(file);
+        if(fd != fileDataHash.end())
+        {
+            depends.erase(fd->second);
+            delete fd->second;
+            fileDataHash.erase(fd);
+        }
+    }
+}
+
+void removeStaleUnitySources(map<FileData*, list<FileData*> >& depends, map<string, FileData*>& fileDataHash)
+{
+    for(set<string>::iterator e = unityRoots.begin(); e != unityRoots.end(); e++)
+        removeStaleUnityFiles(*e, depends, fileDataHash);
+}
@@ -0,0 +1,68 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_unity.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_unity.cpp
+*/
+
+#ifndef _PILE_UNITY_H__
+#define _PILE_UNITY_H__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "pile_depend.h"
+
+/*
+Tells whether a source file has asked not to be put into a unity build.
+Such files contain the comment "pile: no-unity".
+
+Takes: string (source file name)
+Returns: true if the file must be compiled on its own
+         false otherwise
+*/
+bool isUnityUnsafe(const std::string& file);
+
+/*
+Tells whether a source file is a unity file that Pile generated.
+
+Takes: string (source file name)
+       string (object path)
+Returns: true if the file was generated
+         false otherwise
+*/
+bool isUnitySource(const std::string& file, const std::string& objPath);
+
+/*
+Replaces groups of source files with generated unity files which #include
+them.  Sources are grouped by directory and language.
+
+Takes: list<string> (source file names)
+       int (approximate number of sources per unity file)
+       string (object path, where the unity files go)
+       map<FileData*, list<FileData*> > (dependencies, used for weighting)
+       map<string, FileData*> (file data, updated for the new unity files)
+Returns: list<string> (source file names to compile)
+*/
+std::list<std::string> makeUnitySources(const std::list<std::string>& sources, int unitySize, const std::string& objPath, std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+/*
+Deletes the unity files, in the object paths that makeUnitySources() used this
+run, which it did not make this run (like after sources were removed or the
+unity size changed).  This is done once the whole pilefile has been read, since
+every compile() shares the unity directory.
+
+Takes: map<FileData*, list<FileData*> > (dependencies, which forget the files)
+       map<string, FileData*> (file data, which forgets the files)
+*/
+void removeStaleUnitySources(std::map<FileData*, std::list<FileData*> >& depends, std::map<std::string, FileData*>& fileDataHash);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_watch.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains 'pile watch', which builds whenever a file that the build
+reads is saved.  It keeps the include graph between builds like piled does,
+so a save only makes the changed files (and what includes them) be read again.
+The directories of the watched files are watched instead of the files, since
+many editors save by replacing the file.  Making a header that a source
+includes but that could not be found starts a build too.
+*/
+
+#include "pile_global.h"
+#include "pile_watch.h"
+#include "pile_config.h"
+#include "pile_daemon.h"
+#include "pile_depend.h"
+#include "pile_env.h"
+#include "pile_graph.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <ctime>
+#include <set>
+
+#ifdef PILE_LINUX
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+extern Environment env;
+extern Configuration config;
+
+#ifdef PILE_LINUX
+// The build that is running, so that it can be stopped along with pile
+volatile pid_t watchedBuild = -1;
+
+int inotifyFd = -1;
+map<int, string> watchDirs;  // Directories (with a slash), by watch
+set<string> watchedFiles;  // Full paths
+set<string> missingFiles;  // Full paths where missing includes were looked for
+string watchRoot;  // The pilefile's directory, with a slash
+list<string> ignoredDirs;  // Where pile writes, with a slash
+
+
+void stopWatching(int sig)
+{
+    if(watchedBuild > 0)
+        killpg(watchedBuild, SIGTERM);
+    _exit(1);
+}
+
+bool isIgnored(const string& path)
+{
+    for(list<string>::iterator e = ignoredDirs.begin(); e != ignoredDirs.end(); e++)
+    {
+        if(path.compare(0, e->size(), *e) == 0)
+            return true;
+    }
+    return false;
+}
+
+void watchDir(const string& dir)
+{
+    for(map<int, string>::iterator e = watchDirs.begin(); e != watchDirs.end(); e++)
+    {
+        if(e->second == dir)
+            return;
+    }
+    int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+    if(wd >= 0)
+        watchDirs[wd] = dir;
+    else
+        UI_debug_pile("Could not watch %s\n", dir.c_str());
+}
+
+// Watches every file in the include graph, and where its missing includes
+// could be made.
+void watchFiles()
+{
+    watchDir(watchRoot);
+    for(map<string, FileData*>::iterator e = env.fileDataHash.begin(); e != env.fileDataHash.end(); e++)
+    {
+        if(e->second == NULL || !e->second->exists())
+            continue;
+        string path = absolutePath(e->first);
+        if(isIgnored(path + "/"))
+            continue;
+        watchedFiles.insert(path);
+        watchDir(addDirSlash(ioStripToDir(path)));
+    }
+
+    missingFiles.clear();
+    set<string> missing = getMissingIncludes();
+    for(set<string>::iterator e = missing.begin(); e != missing.end(); e++)
+    {
+        string path = absolutePath(*e);
+        string dir = addDirSlash(ioStripToDir(path));
+        if(isIgnored(path) || !ioExists(dir))
+            continue;
+        missingFiles.insert(path);
+        watchDir(dir);
+    }
+}
+
+// Tells whether a change to a file should start a build.
+bool isWatched(const string& path)
+{
+    if(isIgnored(path))
+        return false;
+    if(watchedFiles.find(path) != watchedFiles.end() || missingFiles.find(path) != missingFiles.end())
+        return true;
+    // Pilefiles, and new sources that the pilefile might pick up
+    if(ioStripToExt(path) == "pile")
+        return (addDirSlash(ioStripToDir(path)) == watchRoot);
+    return isSourceFile(path);
+}
+
+/*
+Waits for a change to a watched file.
+
+Takes: int (milliseconds to wait, or -1 to wait forever)
+Returns: true if a watched file changed
+         false otherwise
+*/
+bool waitForChange(int timeout)
+{
+    struct pollfd p;
+    p.fd = inotifyFd;
+    p.events = POLLIN;
+    p.revents = 0;
+    if(poll(&p, 1, timeout) <= 0)
+        return false;
+
+    bool changed = false;
+    char buff[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t size;
+    while((size = read(inotifyFd, buff, sizeof(buff))) > 0)
+    {
+        for(char* e = buff; e < buff + size; e += sizeof(struct inotify_event) + ((struct inotify_event*)e)->len)
+        {
+            struct inotify_event* event = (struct inotify_event*)e;
+            map<int, string>::iterator dir = watchDirs.find(event->wd);
+            if(event->len == 0 || dir == watchDirs.end())
+                continue;
+            string path = dir->second + event->name;
+            if(isWatched(path))
+            {
+                UI_debug_pile("Changed: %s\n", path.c_str());
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+#endif
+
+int runWatch(int argc, char* argv[], int (*runBuild)(int, char*[]))
+{
+    #ifdef PILE_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0)
+    {
+        UI_error("pile error: Could not watch for changes.\n");
+        return 1;
+    }
+    watchRoot = addDirSlash(ioGetCWD());
+    ignoredDirs.push_back(addDirSlash(absolutePath(config.objPath)));
+    ignoredDirs.push_back(addDirSlash(absolutePath(PILE_PROJECT_DIR)));
+    watchFiles();
+    reloadConfig();
+
+    signal(SIGINT, stopWatching);
+    signal(SIGTERM, stopWatching);
+
+    vector<string> args(argv, argv + argc);
+    while(true)
+    {
+        // Only what changed is read again.
+        reloadConfig();
+        refreshDepends(env.depends, env.fileDataHash);
+        watchedBuild = forkBuild(args, runBuild, -1);
+        if(watchedBuild < 0)
+        {
+            UI_error("pile error: Could not start a build.\n");
+            return 1;
+        }
+
+        // A save during the build makes it out of date, so it is stopped.
+        // Anything it finished is kept, since it is still up to date.
+        bool stopped = false;
+        while(waitpid(watchedBuild, NULL, WNOHANG) == 0)
+        {
+            if(waitForChange(100))
+            {
+                killpg(watchedBuild, SIGTERM);
+                waitpid(watchedBuild, NULL, 0);
+                UI_print("\nFiles changed during the build, so it was stopped.\n");
+                stopped = true;
+                break;
+            }
+        }
+        watchedBuild = -1;
+
+        if(!stopped)
+        {
+            keepBuildState();
+            watchFiles();
+            UI_print("\nWatching for changes.  Press Ctrl-C to stop.\n");
+            fflush(stdout);
+            while(!waitForChange(-1))
+            {}
+        }
+
+        // File times are only compared to the second, so an object made in
+        // the same second as the save would look out of date next time.
+        time_t saved = time(NULL);
+        while(time(NULL) == saved)
+            usleep(20000);
+        // Saving often touches several files, so wait until they are done.
+        while(waitForChange(PILE_WATCH_QUIET_MS))
+        {}
+        UI_print("\nBuilding again.\n");
+    }
+    #else
+    UI_error("pile error: 'pile watch' is not supported here yet.\n");
+    return 1;
+    #endif
+}
@@ -0,0 +1,34 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_watch.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_watch.cpp
+*/
+
+#ifndef _PILE_WATCH_H__
+#define _PILE_WATCH_H__
+
+// How long the files have to stay unchanged before a build starts
+#define PILE_WATCH_QUIET_MS 200
+
+/*
+Runs 'pile watch [build arguments]'.  It builds once, then builds again each
+time a pilefile, a source, or a header that the sources include is saved.  A
+save during a build stops that build and starts another.  It must be run in
+the pilefile's directory, after pile.conf is loaded.
+
+Takes: int (number of arguments after 'watch')
+       char*[] (those arguments, which are given to each build)
+       int (*)(int, char*[]) (runs a build, with arguments like main()'s)
+Returns: int (1 if watching is not possible)
+*/
+int runWatch(int argc, char* argv[], int (*runBuild)(int, char*[]));
+
+#endif
@@ -0,0 +1,509 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_worker.cpp
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+This file contains pile-worker, which compiles preprocessed sources for other
+machines, and the remote-compile command that sends it work.
+
+A request looks like this, with the source sent as raw bytes after its size:
+ PILE-WORKER 1
+ compiler g++
+ option -O2
+ language c++
+ signature <hash of the compiler, options, language, and source>
+ source <size>
+ <preprocessed source>end
+
+The worker answers with:
+ PILE-WORKER 1
+ status <compiler exit code, or -1 if the request was refused>
+ output <size>
+ <compiler messages>object <size>
+ <object file>end
+*/
+
+#include "pile_global.h"
+#include "pile_worker.h"
+#include "pile_config.h"
+#include "pile_commands.h"
+#include "pile_net.h"
+#include "pile_ui.h"
+#include "string_functions.h"
+#include "External Code/goodio.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#ifdef PILE_LINUX
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+/*
+Runs a program without a shell, so nothing in the arguments is interpreted.
+
+Takes: vector<string> (program and arguments)
+       string (file for stdout and stderr, or "" to keep Pile's)
+Returns: int (exit code, or -1 if it could not run)
+*/
+int runArgs(const vector<string>& args, const string& outputFile)
+{
+    if(args.size() == 0)
+        return -1;
+
+    #ifdef PILE_LINUX
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        if(outputFile != "")
+        {
+            int fd = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if(fd >= 0)
+            {
+                dup2(fd, 1);
+                dup2(fd, 2);
+                close(fd);
+            }
+        }
+        vector<char*> argv;
+        for(vector<string>::const_iterator e = args.begin(); e != args.end(); e++)
+            argv.push_back(const_cast<char*>(e->c_str()));
+        argv.push_back(NULL);
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+    if(pid < 0)
+        return -1;
+    int status = 0;
+    if(waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+    #else
+    string command;
+    for(vector<string>::const_iterator e = args.begin(); e != args.end(); e++)
+        command += (command == ""? "" : " ") + quoteWhitespace(*e);
+    if(outputFile != "")
+        command += " > " + outputFile + " 2>&1";
+    return system(command.c_str());
+    #endif
+}
+
+// Hash of everything that decides what the object will be.
+string requestSignature(const string& compiler, const vector<string>& options, const string& language, const string& source)
+{
+    string text = ioStripToFile(compiler) + "\n" + language + "\n";
+    for(vector<string>::const_iterator e = options.begin(); e != options.end(); e++)
+        text += *e + "\n";
+    return hashToString(hashString(text + source));
+}
+
+// Sends a block of data with its size first.
+string block(const string& key, const string& data)
+{
+    stringstream str;
+    str << key << " " << data.size() << "\n";
+    return str.str() + data;
+}
+
+// Reads a block of data, given its size from the line before it.  Sizes that
+// are not numbers or are too big are refused before anything is read.
+bool readBlock(Connection& conn, const string& size, string& data)
+{
+    char* end = NULL;
+    unsigned long bytes = strtoul(size.c_str(), &end, 10);
+    if(size == "" || *end != '\0' || bytes > PILE_WORKER_MAX_BYTES)
+        return false;
+    return conn.readBytes(bytes, data);
+}
+
+
+string remoteCompileCommand(const string& worker, const string& command)
+{
+    return quoteWhitespace(getExecutablePath()) + " remote-compile " + quoteWhitespace(worker) + " " + command;
+}
+
+// Options that only matter to the preprocessor, which has already run.  The
+// second set takes the next argument with it.
+bool isPreprocessorOption(const string& option, bool& takesNext)
+{
+    static const char* alone[] = {"-MD", "-MMD", "-MP", "-M", "-MM", NULL};
+    static const char* withNext[] = {"-include", "-imacros", "-isystem", "-iquote", "-idirafter", "-I", "-D", "-U", "-MF", "-MT", "-MQ", "-x", NULL};
+    static const char* prefixes[] = {"-I", "-D", "-U", "-isystem", "-iquote", "-idirafter", NULL};
+
+    takesNext = false;
+    for(int i = 0; alone[i] != NULL; i++)
+    {
+        if(option == alone[i])
+            return true;
+    }
+    for(int i = 0; withNext[i] != NULL; i++)
+    {
+        if(option == withNext[i])
+        {
+            takesNext = true;
+            return true;
+        }
+    }
+    for(int i = 0; prefixes[i] != NULL; i++)
+    {
+        if(option.compare(0, strlen(prefixes[i]), prefixes[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+int remoteCompile(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        UI_error("Usage: pile remote-compile <worker> <compiler> <options> -c <source> -o <object>\n");
+        return 1;
+    }
+
+    string worker = argv[0];
+    vector<string> command(argv + 1, argv + argc);
+
+    // compileCommand() always ends with: -c <source> -o <object>
+    string source;
+    string object;
+    vector<string> options;
+    vector<string> remoteOptions;
+    for(unsigned int i = 1; i < command.size(); i++)
+    {
+        if(command[i] == "-c" && i+1 < command.size())
+            source = command[++i];
+        else if(command[i] == "-o" && i+1 < command.size())
+            object = command[++i];
+        else if(command[i] == "-include-pch" && i+1 < command.size())
+        {
+            // The precompiled header only exists here, and the preprocessed
+            // source would not have what is in it.  The header that it was
+            // made from is preprocessed in instead.
+            string header = command[++i];
+            if(ioStripToExt(header) == "pch")
+                header = header.substr(0, header.size() - 4);
+            if(!ioExists(header))
+                return runArgs(command, "");
+            options.push_back("-include");
+            options.push_back(header);
+        }
+        else
+        {
+            options.push_back(command[i]);
+            bool takesNext;
+            if(!isPreprocessorOption(command[i], takesNext))
+                remoteOptions.push_back(command[i]);
+            else if(takesNext && i+1 < command.size())
+                options.push_back(command[++i]);
+        }
+    }
+    if(source == "" || object == "")
+        return runArgs(command, "");
+
+    string language = (ioStripToExt(source) == "c"? "c" : "c++");
+    string preprocessed = object + (language == "c"? ".i" : ".ii");
+
+    vector<string> preprocess;
+    preprocess.push_back(command[0]);
+    preprocess.insert(preprocess.end(), options.begin(), options.end());
+    preprocess.push_back("-E");
+    preprocess.push_back(source);
+    preprocess.push_back("-o");
+    preprocess.push_back(preprocessed);
+    if(runArgs(preprocess, "") != 0)
+    {
+        // The errors have been printed already.
+        ioDelete(preprocessed);
+        return 1;
+    }
+    string text = readBinaryFile(preprocessed);
+    ioDelete(preprocessed);
+
+    Connection conn;
+    if(!connectTo(worker, conn))
+    {
+        UI_print(" Worker %s is not answering, so %s is built here.\n", worker.c_str(), source.c_str());
+        fflush(stdout);
+        return runArgs(command, "");
+    }
+
+    string request = string(PILE_WORKER_PROTOCOL) + "\n";
+    request += "compiler " + ioStripToFile(command[0]) + "\n";
+    for(vector<string>::iterator e = remoteOptions.begin(); e != remoteOptions.end(); e++)
+        request += "option " + *e + "\n";
+    request += "language " + language + "\n";
+    request += "signature " + requestSignature(command[0], remoteOptions, language, text) + "\n";
+    request += block("source", text) + "end\n";
+
+    string line;
+    int status = -1;
+    string output;
+    string objectData;
+    bool gotObject = false;
+    bool answered = (conn.send(request) && conn.readLine(line) && line == PILE_WORKER_PROTOCOL);
+    while(answered && conn.readLine(line) && line != "end")
+    {
+        string::size_type space = line.find(' ');
+        string key = line.substr(0, space);
+        string value = (space == string::npos? "" : line.substr(space + 1));
+        if(key == "status")
+            status = atoi(value.c_str());
+        else if(key == "output")
+            answered = readBlock(conn, value, output);
+        else if(key == "object")
+            answered = gotObject = readBlock(conn, value, objectData);
+    }
+    if(!answered || line != "end")
+    {
+        UI_print(" Worker %s stopped answering, so %s is built here.\n", worker.c_str(), source.c_str());
+        fflush(stdout);
+        return runArgs(command, "");
+    }
+    if(status < 0)
+    {
+        UI_print(" Worker %s refused %s (%s), so it is built here.\n", worker.c_str(), source.c_str(), output.c_str());
+        fflush(stdout);
+        return runArgs(command, "");
+    }
+
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+    if(status == 0)
+    {
+        ioDelete(object);
+        ofstream fout(object.c_str(), ios::binary | ios::trunc);
+        fout.write(objectData.data(), objectData.size());
+        if(!gotObject || fout.fail())
+        {
+            UI_error("pile error: Could not write %s from worker %s.\n", object.c_str(), worker.c_str());
+            return 1;
+        }
+    }
+    return status;
+}
+
+
+// Options that could make the compiler run something else or write elsewhere.
+// Some are only refused by their exact name, and some also with their value
+// joined on.  An -o with its value joined on doesn't matter, since the
+// worker's own -o comes last.
+bool isRefusedOption(const string& option)
+{
+    static const char* names[] = {"-o", "-B", "-wrapper", "-specs", "--specs", "-fplugin", NULL};
+    static const char* joined[] = {"-B", "-specs=", "--specs=", "-fplugin=", "-fplugin-arg-", "@", NULL};
+    for(int i = 0; names[i] != NULL; i++)
+    {
+        if(option == names[i])
+            return true;
+    }
+    for(int i = 0; joined[i] != NULL; i++)
+    {
+        if(option.compare(0, strlen(joined[i]), joined[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Sends a refusal, which makes the client compile for itself.
+void refuse(Connection& conn, const string& reason)
+{
+    conn.send(string(PILE_WORKER_PROTOCOL) + "\nstatus -1\n" + block("output", reason) + "end\n");
+}
+
+// Answers one compile request.
+void serveCompile(Connection& conn, const set<string>& compilers)
+{
+    string line;
+    if(!conn.readLine(line) || line != PILE_WORKER_PROTOCOL)
+    {
+        refuse(conn, "unknown protocol");
+        return;
+    }
+
+    string compiler;
+    vector<string> options;
+    string language = "c++";
+    string signature;
+    string source;
+    while(conn.readLine(line) && line != "end")
+    {
+        string::size_type space = line.find(' ');
+        string key = line.substr(0, space);
+        string value = (space == string::npos? "" : line.substr(space + 1));
+        if(key == "compiler")
+            compiler = value;
+        else if(key == "option")
+            options.push_back(value);
+        else if(key == "language")
+            language = value;
+        else if(key == "signature")
+            signature = value;
+        else if(key == "source" && !readBlock(conn, value, source))
+        {
+            refuse(conn, "the source is too big or did not arrive");
+            return;
+        }
+    }
+    if(line != "end")
+        return;
+
+    if(compilers.find(compiler) == compilers.end())
+    {
+        refuse(conn, "compiler " + compiler + " is not allowed");
+        return;
+    }
+    for(vector<string>::iterator e = options.begin(); e != options.end(); e++)
+    {
+        if(isRefusedOption(*e))
+        {
+            refuse(conn, "option " + *e + " is not allowed");
+            return;
+        }
+    }
+    if(language != "c" && language != "c++")
+    {
+        refuse(conn, "language " + language + " is not known");
+        return;
+    }
+    if(requestSignature(compiler, options, language, source) != signature)
+    {
+        refuse(conn, "the source did not arrive whole");
+        return;
+    }
+
+    #ifdef PILE_LINUX
+    char dirName[] = "/tmp/pile-worker.XXXXXX";
+    if(mkdtemp(dirName) == NULL)
+    {
+        refuse(conn, "the worker has no room");
+        return;
+    }
+    string dir = dirName;
+    #else
+    string dir = ".";
+    #endif
+    string input = dir + (language == "c"? "/source.i" : "/source.ii");
+    string object = dir + "/source.o";
+    string log = dir + "/output.txt";
+
+    int status = -1;
+    ofstream fout(input.c_str(), ios::binary | ios::trunc);
+    fout.write(source.data(), source.size());
+    fout.close();
+    if(!fout.fail())
+    {
+        vector<string> args;
+        args.push_back(compiler);
+        args.insert(args.end(), options.begin(), options.end());
+        args.push_back("-c");
+        args.push_back(input);
+        args.push_back("-o");
+        args.push_back(object);
+        status = runArgs(args, log);
+    }
+    if(status < 0)
+        status = 1;
+
+    string answer = string(PILE_WORKER_PROTOCOL) + "\n";
+    stringstream str;
+    str << "status " << status << "\n";
+    answer += str.str() + block("output", readBinaryFile(log));
+    if(status == 0)
+        answer += block("object", readBinaryFile(object));
+    answer += "end\n";
+    conn.send(answer);
+
+    UI_print(" Compiled %s: %s\n", signature.c_str(), (status == 0? "done" : "failed"));
+    fflush(stdout);
+
+    ioDelete(input);
+    ioDelete(object);
+    ioDelete(log);
+    #ifdef PILE_LINUX
+    rmdir(dir.c_str());
+    #endif
+}
+
+int runWorker(int argc, char* argv[])
+{
+    string address = PILE_WORKER_DEFAULT_ADDRESS;
+    int slots = getCPUCount();
+    set<string> compilers;
+    compilers.insert("gcc");
+    compilers.insert("g++");
+    compilers.insert("cc");
+    compilers.insert("c++");
+    compilers.insert("clang");
+    compilers.insert("clang++");
+
+    for(int i = 0; i < argc; i++)
+    {
+        if(string("-j") == argv[i] && i+1 < argc)
+            slots = atoi(argv[++i]);
+        else if(strncmp(argv[i], "-j", 2) == 0)
+            slots = atoi(argv[i] + 2);
+        else if(string("--compilers") == argv[i] && i+1 < argc)
+        {
+            compilers.clear();
+            list<string> ls = ioExplode(argv[++i], ',');
+            for(list<string>::iterator e = ls.begin(); e != ls.end(); e++)
+            {
+                if(*e != "")
+                    compilers.insert(*e);
+            }
+        }
+        else
+            address = argv[i];
+    }
+    if(slots < 1)
+        slots = 1;
+
+    #ifdef PILE_LINUX
+    int listener = listenOn(address);
+    if(listener < 0)
+    {
+        UI_error("pile error: pile-worker could not listen on %s.\n", address.c_str());
+        return 1;
+    }
+    UI_print("pile-worker listening on %s, %d compiles at a time.\n", address.c_str(), slots);
+    fflush(stdout);
+
+    // Each request is answered by its own process.
+    int running = 0;
+    while(true)
+    {
+        while(running > 0 && waitpid(-1, NULL, (running >= slots? 0 : WNOHANG)) > 0)
+            running--;
+
+        Connection conn;
+        if(!acceptConnection(listener, conn))
+            continue;
+
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            close(listener);
+            serveCompile(conn, compilers);
+            conn.close();
+            _exit(0);
+        }
+        if(pid > 0)
+            running++;
+    }
+    #else
+    UI_error("pile error: pile-worker is not supported here yet.\n");
+    return 1;
+    #endif
+}
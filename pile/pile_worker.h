@@ -0,0 +1,62 @@
+/*
+Pile, a truly cross-platform automatic build tool.
+--------------------------------------------------
+
+pile_worker.h
+
+Copyright Jonathan Dearborn 2009
+
+Licensed under the GNU Public License (GPL)
+See COPYING.txt
+
+Header for pile_worker.cpp
+*/
+
+#ifndef _PILE_WORKER_H__
+#define _PILE_WORKER_H__
+
+#include <string>
+
+// Where pile-worker listens if it is not told
+#define PILE_WORKER_DEFAULT_ADDRESS "127.0.0.1:7070"
+
+// The first line of every worker message, in both directions
+#define PILE_WORKER_PROTOCOL "PILE-WORKER 1"
+
+// The biggest source, object, or output that a worker message may hold
+#define PILE_WORKER_MAX_BYTES (256UL*1024*1024)
+
+/*
+Gets the command which runs a compile on a worker instead of here.
+
+Takes: string (worker address)
+       string (compile command, as from compileCommand())
+Returns: string (the command)
+*/
+std::string remoteCompileCommand(const std::string& worker, const std::string& command);
+
+/*
+Runs 'pile remote-compile <worker> <compiler> <options> -c <source> -o <object>'.
+The source is preprocessed here and sent to the worker, which compiles it and
+sends back the object and the compiler's messages.  If the worker can't be
+reached or refuses, the source is compiled here instead.
+
+Takes: int (number of arguments after 'remote-compile')
+       char*[] (those arguments)
+Returns: int (the compiler's exit code)
+*/
+int remoteCompile(int argc, char* argv[]);
+
+/*
+Runs 'pile worker [address] [-j N] [--compilers gcc,g++]', which is also what
+'pile-worker' does.  It listens for compiles forever, running up to N at once.
+Only the named compilers (by default gcc, g++, cc, c++, clang, and clang++)
+are run, and only from the PATH.
+
+Takes: int (number of arguments after 'worker')
+       char*[] (those arguments)
+Returns: int (1 if the worker could not start)
+*/
+int runWorker(int argc, char* argv[]);
+
+#endif
@@ -15,6 +15,7 @@ This file contains random, useful functions for manipulating strings.
 #include "External Code/goodio.h"
 #include "pile_system.h"
 #include "string_functions.h"
+#include <cstdio>
 using namespace std;
 
 bool isWhitespace(const char& c);
@@ -41,7 +42,7 @@ void toLower(string& text)
 
 string getBaseName(string file)
 {
-    unsigned int dotpos = file.find_last_of(".");
+    string::size_type dotpos = file.find_last_of(".");
     if(dotpos != string::npos)
         file = file.substr(0, dotpos);
     return file;
@@ -114,6 +115,141 @@ string removeQuotes(string str)
 
 
 
+/*
+Gets a path to a file which can be used from inside the given directory.
+
+Takes: string (directory)
+       string (file name, relative to the current directory)
+Returns: string (file name, relative to the directory if possible)
+*/
+string pathFromDir(const string& dir, const string& file)
+{
+    if(file.size() > 0 && file[0] == '/')
+        return file;
+
+    string up;
+    list<string> parts = ioExplode(dir, '/');
+    for(list<string>::iterator e = parts.begin(); e != parts.end(); e++)
+    {
+        if(*e == "" || *e == ".")
+            continue;
+        if(*e == ".." || dir[0] == '/')
+            return addDirSlash(ioGetCWD()) + file;
+        up += "../";
+    }
+    return up + file;
+}
+
+string absolutePath(const string& file)
+{
+    string path = file;
+    for(unsigned int i = 0; i < path.size(); i++)
+    {
+        if(path[i] == '\\')
+            path[i] = '/';
+    }
+    if(path.size() == 0 || (path[0] != '/' && !(path.size() > 1 && path[1] == ':')))
+        path = addDirSlash(ioGetCWD()) + path;
+
+    // Take out the "." and ".." parts.
+    vector<string> result;
+    list<string> parts = ioExplode(path, '/');
+    for(list<string>::iterator e = parts.begin(); e != parts.end(); e++)
+    {
+        if(*e == "" || *e == ".")
+            continue;
+        if(*e == "..")
+        {
+            if(result.size() > 0)
+                result.pop_back();
+            continue;
+        }
+        result.push_back(*e);
+    }
+
+    string text = (path[0] == '/'? "/" : "");
+    for(vector<string>::iterator e = result.begin(); e != result.end(); e++)
+    {
+        if(e != result.begin())
+            text += "/";
+        text += *e;
+    }
+    return text;
+}
+
+string relativeToDir(const string& dir, const string& file)
+{
+    string root = dir;
+    while(root.size() > 1 && root[root.size()-1] == '/')
+        root.erase(root.size()-1);
+    if(file == root)
+        return ".";
+    if(file.size() > root.size() && file.compare(0, root.size(), root) == 0 && file[root.size()] == '/')
+        return file.substr(root.size() + 1);
+    return file;
+}
+
+string mapPathPrefix(const string& dir, const string& text)
+{
+    string root = dir;
+    while(root.size() > 1 && root[root.size()-1] == '/')
+        root.erase(root.size()-1);
+    if(root.size() <= 1)
+        return text;
+
+    string result;
+    string::size_type start = 0;
+    string::size_type found;
+    while((found = text.find(root, start)) != string::npos)
+    {
+        string::size_type end = found + root.size();
+        result += text.substr(start, found - start);
+        // "/home/me/src2" is not inside "/home/me/src".
+        if(end < text.size() && text[end] == '/')
+            result += ".";
+        else if(end == text.size() || text[end] == ' ' || text[end] == '=' || text[end] == '"' || text[end] == ':')
+            result += ".";
+        else
+            result += root;
+        start = end;
+    }
+    return result + text.substr(start);
+}
+
+unsigned long hashString(const string& str)
+{
+    unsigned long hash = 2166136261UL;
+    for(unsigned int i = 0; i < str.size(); i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619UL;
+        hash &= 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+string hashToString(unsigned long hash)
+{
+    char buff[32];
+    sprintf(buff, "%08lx", hash);
+    return buff;
+}
+
+string joinArgs(const vector<string>& args)
+{
+    string result;
+    for(vector<string>::const_iterator e = args.begin(); e != args.end(); e++)
+    {
+        if(*e == "")
+            continue;
+        if(result != "")
+            result += " ";
+        result += *e;
+    }
+    return result;
+}
+
+
 /*
 Creates a name for an executable by changing the file extension.
 
@@ -122,7 +258,7 @@ Returns: string (converted name)
 */
 string getExeName(string file)
 {
-    unsigned int dotpos = file.find_last_of(".");
+    string::size_type dotpos = file.find_last_of(".");
     if(dotpos != string::npos)
     {
         return (file.substr(0, dotpos) + EXE_EXT);
@@ -137,7 +273,7 @@ string getExeName(string file)
 
 void removePath(string& file)
 {
-    unsigned int lastSlash = file.find_last_of('/');
+    string::size_type lastSlash = file.find_last_of('/');
     if(lastSlash != string::npos)
     {
         file = file.substr(lastSlash+1, string::npos);
@@ -158,7 +294,7 @@ string getObjectString(const list<string>& sources, const list<string>& objects)
     for(list<string>::const_iterator e = sources.begin(); e != sources.end(); e++)
     {
         string obj = *e;
-        unsigned int dotpos = e->find_last_of(".");
+        string::size_type dotpos = e->find_last_of(".");
         if(dotpos != string::npos)  // Perhaps unneccessary
         {
             obj = obj.substr(0, dotpos) + ".o";
@@ -200,7 +336,7 @@ Returns: true if file is a source file
 */
 bool isSourceFile(const string& file)
 {
-    unsigned int dotpos = file.find_last_of(".");
+    string::size_type dotpos = file.find_last_of(".");
     if(dotpos != string::npos)
     {
         string ext = file.substr(dotpos, string::npos);
@@ -17,6 +17,7 @@ Header for string_functions.cpp
 
 #include <list>
 #include <string>
+#include <vector>
 
 bool firstChar(const std::string& text, const char& c);
 
@@ -34,6 +35,65 @@ std::string quoteThis(std::string str);
 
 std::string removeQuotes(std::string str);
 
+/*
+Gets a path to a file which can be used from inside the given directory.
+
+Takes: string (directory)
+       string (file name, relative to the current directory)
+Returns: string (file name, relative to the directory if possible)
+*/
+std::string pathFromDir(const std::string& dir, const std::string& file);
+
+/*
+Gets the full path of a file, without any "." or ".." parts, so that two names
+for the same file can be compared.
+
+Takes: string (file name, relative to the current directory)
+Returns: string (full path)
+*/
+std::string absolutePath(const std::string& file);
+
+/*
+Gets a path relative to a directory (like the project's) if it is inside it,
+so that the same file has the same name in every checkout.
+
+Takes: string (directory, as a full path)
+       string (file name)
+Returns: string (file name relative to the directory, "." for the directory
+                 itself, or the file name unchanged if it is outside)
+*/
+std::string relativeToDir(const std::string& dir, const std::string& file);
+
+/*
+Rewrites every path in some text (like compiler options) that starts with the
+given directory so that it is relative to that directory.
+
+Takes: string (directory, as a full path)
+       string (text)
+Returns: string (the rewritten text)
+*/
+std::string mapPathPrefix(const std::string& dir, const std::string& text);
+
+/*
+Calculates a simple (FNV-1a) hash of a string.  This is not cryptographic; it
+is used for picking stable names and fingerprints.
+
+Takes: string (text to hash)
+Returns: unsigned long (the hash)
+*/
+unsigned long hashString(const std::string& str);
+
+std::string hashToString(unsigned long hash);
+
+/*
+Joins the words of a command line with spaces.  Each word is already quoted as
+it should be.  Empty words are skipped.
+
+Takes: vector<string> (command words)
+Returns: string (the command line)
+*/
+std::string joinArgs(const std::vector<std::string>& args);
+
 /*
 Creates a name for an executable by changing the file extension.
 
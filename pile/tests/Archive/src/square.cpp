@@ -0,0 +1,6 @@
+#include "shapes.h"
+
+int square(int side)
+{
+    return side * side;
+}
@@ -0,0 +1,11 @@
+#include <cstdio>
+
+int one();
+int two();
+int three();
+
+int main(int argc, char* argv[])
+{
+    printf("%d\n", one() + two() + three());
+    return 0;
+}
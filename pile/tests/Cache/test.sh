@@ -0,0 +1,37 @@
+#!/bin/bash
+# Starts a pile-cache-server, builds two checkouts of the PCH test in
+# different directories, and checks that the second one downloads every
+# object and the program instead of building them.
+#
+# Usage: ./test.sh
+# Set PILE to the pile executable if it is not in your PATH.
+
+PILE=${PILE:-pile}
+PORT=${PORT:-7081}
+WORK=${WORK:-/tmp/pile_cache_test}
+
+rm -rf "$WORK"
+mkdir -p "$WORK/cache"
+cp -r "$(dirname "$0")/../PCH" "$WORK/first"
+cp -r "$(dirname "$0")/../PCH" "$WORK/second"
+
+"$PILE" cache-server 127.0.0.1:$PORT --dir "$WORK/cache" > "$WORK/server.txt" 2>&1 &
+trap 'kill $! 2> /dev/null' EXIT
+sleep 1
+
+fail()
+{
+    echo "$1"
+    cat "$WORK/$2.txt"
+    exit 1
+}
+
+(cd "$WORK/first" && "$PILE" --no-daemon --cache 127.0.0.1:$PORT > ../first.txt 2>&1) || fail "The first build failed." first
+# Uploads happen in the background.
+sleep 2
+(cd "$WORK/second" && "$PILE" --no-daemon --cache 127.0.0.1:$PORT > ../second.txt 2>&1) || fail "The second build failed." second
+
+grep -q "Building" "$WORK/second.txt" && fail "The second build compiled something." second
+grep -q "Linking" "$WORK/second.txt" && fail "The second build linked something." second
+[ "$("$WORK/second/myprog")" = "$("$WORK/first/myprog")" ] || fail "The programs give different answers." second
+echo "The second build downloaded $(grep -c Downloaded "$WORK/second.txt") files."
@@ -0,0 +1,95 @@
+#!/bin/bash
+# Compares full and incremental (partial) relinks on a synthetic large target.
+# Only the link jobs are timed (the final link, and the partial links for
+# incremental), as .pile/history recorded them.  Each mode is its own variant,
+# so it has its own object directory.
+#
+# Usage: ./benchmark.sh [directories] [files per directory] [runs]
+# Set PILE to the pile executable if it is not in your PATH.
+
+PILE=${PILE:-pile}
+DIRS=${1:-50}
+FILES=${2:-100}
+RUNS=${3:-5}
+WORK=${WORK:-/tmp/pile_link_benchmark}
+
+rm -rf "$WORK"
+mkdir -p "$WORK"
+cd "$WORK" || exit 1
+
+echo "Generating $((DIRS * FILES)) sources in $DIRS directories..."
+for d in $(seq 1 $DIRS); do
+    mkdir -p src/d$d
+    echo "int d${d}_sum();" > src/d$d/d$d.h
+    for f in $(seq 1 $FILES); do
+        {
+            echo "#include \"d$d.h\""
+            echo "static const char data_${d}_$f[] = \"$d-$f\";"
+            echo "int f_${d}_$f() { return data_${d}_$f[0]; }"
+        } > src/d$d/f$f.cpp
+    done
+    {
+        echo "#include \"d$d.h\""
+        for f in $(seq 1 $FILES); do echo "int f_${d}_$f();"; done
+        echo "int d${d}_sum() { int s = 0;"
+        for f in $(seq 1 $FILES); do echo "s += f_${d}_$f();"; done
+        echo "return s; }"
+    } > src/d$d/sum.cpp
+done
+{
+    echo "#include <cstdio>"
+    for d in $(seq 1 $DIRS); do echo "#include \"src/d$d/d$d.h\""; done
+    echo "int main() { int s = 0;"
+    for d in $(seq 1 $DIRS); do echo "s += d${d}_sum();"; done
+    echo "printf(\"%d\\n\", s); return 0; }"
+} > main.cpp
+
+for mode in full incremental; do
+    {
+        if [ $mode = incremental ]; then echo "cpp_linker.incremental = true"; fi
+        echo "cpp_compiler.batch_size = 100"
+        for d in $(seq 1 $DIRS); do echo "SOURCES += ls(\"src/d$d/*.cpp\")"; done
+        echo "SOURCES += [\"main.cpp\"]"
+        echo "cpp_compiler.scan(SOURCES)"
+        echo "array<string> objs = cpp_compiler.compile(SOURCES, CFLAGS)"
+        echo "cpp_linker.link(\"prog_$mode\", objs, LIBRARIES, LFLAGS)"
+    } > $mode.pile
+done
+
+# Adds up the link jobs of the last build in the history: the program's link
+# and any partial links.  Compiles are left out.
+link_ms()
+{
+    awk -v prog="prog_$1" '
+        /^build / { total = 0 }
+        /^ job / && ($NF ~ prog "$" || $NF ~ /\/partial\//) { total += $2 }
+        END { print total }' .pile/history
+}
+
+# Builds everything once, then times the links of rebuilds after touching one
+# source.
+run()
+{
+    mode=$1
+    "$PILE" -v $mode $mode.pile > /dev/null 2>&1
+    sleep 1
+    total=0
+    for r in $(seq 1 $RUNS); do
+        touch src/d$(( (r % DIRS) + 1 ))/f1.cpp
+        sleep 1
+        "$PILE" -v $mode $mode.pile > /dev/null 2>&1
+        total=$(( total + $(link_ms $mode) ))
+        sleep 1
+    done
+    echo "$mode: $(( total / RUNS )) ms of link jobs per rebuild after touching one source (average of $RUNS)"
+}
+
+run full
+run incremental
+
+full/prog_full > full.txt
+incremental/prog_incremental > incremental.txt
+if ! cmp -s full.txt incremental.txt; then
+    echo "The two programs give different results!"
+    exit 1
+fi
@@ -0,0 +1,7 @@
+#ifndef _CORE_H__
+#define _CORE_H__
+
+int start();
+int stop();
+
+#endif
@@ -0,0 +1,7 @@
+#include "core.h"
+#include "../util/util.h"
+
+int stop()
+{
+    return half(8);
+}
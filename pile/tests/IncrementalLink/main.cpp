@@ -0,0 +1,8 @@
+#include <cstdio>
+#include "core/core.h"
+
+int main(int argc, char* argv[])
+{
+    printf("%d\n", start() + stop());
+    return 0;
+}
@@ -0,0 +1,6 @@
+#include "util.h"
+
+int half(int value)
+{
+    return value / 2;
+}
@@ -0,0 +1,6 @@
+#include "util.h"
+
+int twice(int value)
+{
+    return value * 2;
+}
@@ -0,0 +1,7 @@
+#ifndef _UTIL_H__
+#define _UTIL_H__
+
+int twice(int value);
+int half(int value);
+
+#endif
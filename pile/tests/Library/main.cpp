@@ -0,0 +1,8 @@
+#include <cstdio>
+#include "src/shapes.h"
+
+int main(int argc, char* argv[])
+{
+    printf("%d\n", square(3) + rectangle(2, 4));
+    return 0;
+}
@@ -0,0 +1,6 @@
+#include "shapes.h"
+
+int rectangle(int width, int height)
+{
+    return width * height;
+}
@@ -0,0 +1,7 @@
+#ifndef _SHAPES_H__
+#define _SHAPES_H__
+
+int square(int side);
+int rectangle(int width, int height);
+
+#endif
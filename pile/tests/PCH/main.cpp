@@ -0,0 +1,12 @@
+#include <cstdio>
+
+int one();
+int two();
+int three();
+int odd();
+
+int main(int argc, char* argv[])
+{
+    printf("%d\n", one() + two() + three() + odd());
+    return 0;
+}
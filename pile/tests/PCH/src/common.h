@@ -0,0 +1,16 @@
+/*
+common.h
+
+Shared by most of the sources.  The comment comes before the include guard,
+like a license would.
+*/
+
+#ifndef _COMMON_H__
+#define _COMMON_H__
+
+#include <string>
+#include <vector>
+
+std::string join(const std::vector<std::string>& words);
+
+#endif
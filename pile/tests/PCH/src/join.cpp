@@ -0,0 +1,9 @@
+#include "common.h"
+
+std::string join(const std::vector<std::string>& words)
+{
+    std::string result;
+    for(unsigned int i = 0; i < words.size(); i++)
+        result += words[i];
+    return result;
+}
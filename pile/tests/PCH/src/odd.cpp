@@ -0,0 +1,6 @@
+#include <cstdlib>
+
+int odd()
+{
+    return abs(-1);
+}
@@ -0,0 +1,8 @@
+#include "common.h"
+
+int one()
+{
+    std::vector<std::string> words;
+    words.push_back("one");
+    return join(words).size();
+}
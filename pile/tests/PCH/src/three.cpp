@@ -0,0 +1,8 @@
+#include "common.h"
+
+int three()
+{
+    std::vector<std::string> words;
+    words.push_back("three");
+    return join(words).size();
+}
@@ -0,0 +1,8 @@
+#include "common.h"
+
+int two()
+{
+    std::vector<std::string> words;
+    words.push_back("two");
+    return join(words).size();
+}
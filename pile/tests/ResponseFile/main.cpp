@@ -0,0 +1,9 @@
+#include <cstdio>
+
+int sum_parts();
+
+int main(int argc, char* argv[])
+{
+    printf("Sum of the parts: %d\n", sum_parts());
+    return 0;
+}
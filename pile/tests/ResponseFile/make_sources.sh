@@ -0,0 +1,35 @@
+#!/bin/sh
+# Writes the many small sources that com.pile links.  They are only written
+# once, so that later builds have nothing to compile.
+#
+# Usage: sh make_sources.sh [files]
+
+FILES=${1:-300}
+
+if [ -d src ]; then
+    exit 0
+fi
+mkdir -p src
+
+i=1
+while [ $i -le $FILES ]; do
+    echo "int response_file_part_$i() { return $i; }" > src/response_file_part_$i.cpp
+    i=$((i + 1))
+done
+
+# sum.cpp calls every part, so the program only links if every object was
+# read from the response file.
+{
+    i=1
+    while [ $i -le $FILES ]; do
+        echo "int response_file_part_$i();"
+        i=$((i + 1))
+    done
+    echo "int sum_parts() { int s = 0;"
+    i=1
+    while [ $i -le $FILES ]; do
+        echo "s += response_file_part_$i();"
+        i=$((i + 1))
+    done
+    echo "return s; }"
+} > src/sum.cpp
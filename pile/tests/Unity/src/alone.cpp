@@ -0,0 +1,12 @@
+// pile: no-unity
+// This file's static helper would clash with the others in a unity file.
+
+static int helper()
+{
+    return 1;
+}
+
+int alone()
+{
+    return helper();
+}
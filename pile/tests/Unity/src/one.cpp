@@ -0,0 +1,6 @@
+#include "shared.h"
+
+int one()
+{
+    return SHARED_VALUE;
+}
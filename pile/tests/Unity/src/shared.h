@@ -0,0 +1 @@
+#define SHARED_VALUE 1
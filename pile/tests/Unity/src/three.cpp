@@ -0,0 +1,6 @@
+#include "shared.h"
+
+int three()
+{
+    return SHARED_VALUE;
+}
@@ -0,0 +1,6 @@
+#include "shared.h"
+
+int two()
+{
+    return SHARED_VALUE;
+}
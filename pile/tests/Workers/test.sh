@@ -0,0 +1,39 @@
+#!/bin/bash
+# Builds the PCH test with its compiles sent to two pile-workers on this
+# machine (one on a port, one on a unix socket), then checks that every
+# compile went to a worker and that the program runs.  The sources use a
+# precompiled header, which stays here, so the workers get the header's text.
+#
+# Usage: ./test.sh
+# Set PILE to the pile executable if it is not in your PATH.
+
+PILE=${PILE:-pile}
+PORT=${PORT:-7071}
+WORK=${WORK:-/tmp/pile_worker_test}
+SOCKET=$WORK.sock
+
+rm -rf "$WORK" "$SOCKET"
+cp -r "$(dirname "$0")/../PCH" "$WORK"
+cd "$WORK" || exit 1
+
+"$PILE" worker 127.0.0.1:$PORT -j 2 > worker_port.txt 2>&1 &
+PIDS=$!
+"$PILE" worker "$SOCKET" -j 2 > worker_socket.txt 2>&1 &
+PIDS="$PIDS $!"
+trap 'kill $PIDS 2> /dev/null' EXIT
+sleep 1
+
+fail()
+{
+    echo "$1"
+    cat build.txt
+    exit 1
+}
+
+# With one local slot, the other compiles only have the workers to go to.
+"$PILE" --no-daemon -j 1 --workers 127.0.0.1:$PORT,$SOCKET,127.0.0.1:$PORT,$SOCKET > build.txt 2>&1 || fail "The build failed."
+grep -q " on 127.0.0.1:$PORT" build.txt || fail "Nothing was sent to the worker on port $PORT."
+grep -q " on $SOCKET" build.txt || fail "Nothing was sent to the worker on $SOCKET."
+grep -q "built here" build.txt && fail "A worker did not build what it was sent."
+[ "$(./myprog)" = "12" ] || fail "The program gave the wrong answer."
+echo "The workers built $(grep -c ' on ' build.txt) of the compiles."